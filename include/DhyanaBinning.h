@@ -0,0 +1,52 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaBinning.h
+
+#ifndef DHYANABINNING_H_
+#define DHYANABINNING_H_
+
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \brief software binning of a 16 bits frame, used during the copy into the Lima buffer
+ *
+ * out_w x out_h pixels are written to dst, each one is the sum (saturated to 65535)
+ * or the average of a bin_x x bin_y block of src. src_stride is the nb of pixels
+ * between 2 lines of src. AVX2 or NEON is used if the cpu has it.
+ *******************************************************************/
+LIBDHYANA_API void binFrame16(const unsigned short* src, int src_stride,
+                              unsigned short* dst, int out_w, int out_h,
+                              int bin_x, int bin_y, bool average);
+
+//name of the kernel selected for this cpu : "avx2", "neon" or "scalar"
+LIBDHYANA_API const char* binFrameKernel();
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANABINNING_H_ */
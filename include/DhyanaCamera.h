@@ -30,8 +30,14 @@
 
 #include <ostream>
 #include <map>
+#include <vector>
+#include <atomic>
 #include <pthread.h>
 #include "DhyanaCompatibility.h"
+#include "DhyanaFrameQueue.h"
+#include "DhyanaFrameStats.h"
+#include "DhyanaPropertyCache.h"
+#include "DhyanaLatencyHistogram.h"
 #include "lima/HwBufferMgr.h"
 #include "lima/HwInterface.h"
 #include "lima/Debug.h"
@@ -55,6 +61,27 @@ const int PIXEL_NB_HEIGHT = 2048;
 class BufferCtrlObj;
 class CSoftTriggerTimer;
 
+const int TELEMETRY_HISTORY_SIZE = 600; // samples kept by the telemetry thread (10 min at 1 Hz)
+const int NB_OUTPUT_PORTS = 3; // trigger output ports of the camera
+
+//one sample of the telemetry thread
+struct TelemetrySample
+{
+    double timestamp; // host time (s)
+    double temperature;
+    double temperature_target;
+    int    fan_speed;
+};
+
+//ROI constraints of the camera, in camera pixels : offsets and sizes are multiples of these steps
+struct RoiAlignment
+{
+    int x_step;
+    int y_step;
+    int width_step;
+    int height_step;
+};
+
 /*******************************************************************
  * \class Camera
  * \brief object controlling the Dhyana camera
@@ -67,7 +94,7 @@ public:
 
     enum Status
     {
-        Ready, Exposure, Readout, Latency, Fault
+        Ready, Exposure, Readout, Latency, Fault, Initializing
     } ;
 
     enum TucamTriggerMode
@@ -103,11 +130,81 @@ public:
       GainHigh = TUGAIN_HIGH,
       GainLow  = TUGAIN_LOW
     };
+
+    //binned pixel value, TUIDC_BINNING_SUM or TUIDC_BINNING_AVG for hardware binning
+    enum BinMode
+    {
+      BinSum,
+      BinAvg
+    };
+
+    //stages measured by the latency histograms
+    enum LatencyStage
+    {
+        StageSdkWait,           // per frame : TUCAM_Buf_WaitForFrame
+        StageCopy,              // per frame : readFrame
+        StageNewFrameReady,     // per frame : Lima newFrameReady
+        StageDelivery,          // per frame : from the SDK frame received to newFrameReady done
+        StageFramePeriod,       // per frame : time between 2 frames received
+        StagePrepare,           // per acquisition : prepareAcq
+        StageStart,             // per acquisition : startAcq
+        StageStop,              // per acquisition : stopAcq
+        NbLatencyStages
+    };
+
+    //phases of the camera initialization, timed at construction
+    enum InitPhase
+    {
+        InitOpen,               // TUCAM_Api_Init and TUCAM_Dev_Open
+        InitColdStart,          // fake capture needed after power on
+        InitArmLatency,         // arm latency measure, once per model
+        InitHwTimestamp,        // TUIDC_ENABLETIMESTAMP
+        InitImageType,          // readout modes
+        InitBinning,            // hardware binning factors
+        InitRoiAlignment,       // ROI constraints
+        NbInitPhases
+    };
+
+    //what to do when frames are missing in the SDK frame index sequence
+    enum DropPolicy
+    {
+      DropRenumber,   // next frames get the next Lima frame numbers
+      DropInsertBlank,// a blank frame is delivered for each missing frame
+      DropFault       // acquisition is stopped, status is Fault
+    };
+
+    //settings of one trigger output port
+    struct OutputSignal
+    {
+        TucamSignal         signal;
+        TucamSignalEdge     edge;
+        int                 delay;
+        int                 width;
+    };
+
+    //settings switched together by applyProfile, only the ones which differ are written
+    struct Profile
+    {
+        double              exp_time;   // (s)
+        Roi                 roi;        // Lima roi, in binned pixels
+        Bin                 bin;        // binning of roi
+        TucamGain           global_gain;
+        TrigMode            lima_trigger_mode; // IntTrig, ExtGate (TUCTE_WIDTH)...
+        TucamTriggerMode    trigger_mode;
+        TucamTriggerEdge    trigger_edge;
+        OutputSignal        outputs[NB_OUTPUT_PORTS];
+    };
     
-    Camera(unsigned short timer_period_ms);
+    //camera_id selects the camera by index ("0", "1"...) or by serial number ("sn:<serial>"), the first free camera if empty
+    //with async_init the camera is initialized by a thread, status is Initializing until it is done
+    Camera(unsigned short timer_period_ms, const std::string& camera_id = "", bool async_init = false);
     virtual ~Camera();
 
     void init();
+    //block until the initialization is done, throw if it failed
+    void waitInitDone();
+    //duration of each InitPhase (ms), total includes the waits for the SDK session lock
+    void getInitTimings(std::vector<double>& phases_ms, double& total_ms);
     void reset();
     void prepareAcq();
     void startAcq();
@@ -167,6 +264,8 @@ public:
     void getGlobalGain(TucamGain& gain);
     void getTucamVersion(std::string& version);
     void getFirmwareVersion(std::string& version);
+    void getCameraIndex(int& index);
+    void getSerialNumber(std::string& serial);
     
     void getTriggerMode(TucamTriggerMode& mode){mode = m_tucam_trigger_mode;};
     void setTriggerMode(TucamTriggerMode mode){m_tucam_trigger_mode = mode;};
@@ -174,6 +273,68 @@ public:
     void setTriggerEdge(TucamTriggerEdge edge){m_tucam_trigger_edge_mode = edge;};
     void getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width);
     void setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge=SignalEdgeRising, int delay=-1, int width=-1);
+    void setZeroCopy(bool enable);
+    void getZeroCopy(bool& enable);
+    void setNbSdkBuffers(int nb_buffers);
+    void getNbSdkBuffers(int& nb_buffers);
+    void getQueueHighWaterMark(int& nb_frames);
+    void getBufferCacheHits(int& nb_hits);
+    void getBufferCacheMisses(int& nb_misses);
+    void getArmLatency(double& latency_ms);
+    void setBinMode(BinMode mode);
+    void getBinMode(BinMode& mode);
+    void getSoftwareBinning(bool& enable);
+    void setKeepArmed(bool enable);
+    void getKeepArmed(bool& enable);
+    void getTriggerJitter(double& mean_us, double& std_us, double& max_us);
+    void getFramePeriod(double& target_ms, double& mean_ms, double& max_error_ms);
+    void setHwTimestamp(bool enable);
+    void getHwTimestamp(bool& enable);
+    void getTimestampFit(double& slope, double& offset, double& rms_us);
+    void setDropPolicy(DropPolicy policy);
+    void getDropPolicy(DropPolicy& policy);
+    void getDroppedFrames(int& nb_frames);
+    void getDuplicatedFrames(int& nb_frames);
+    //consistent snapshot of the per-stage frame counters, never blocks the acquisition
+    void getFrameCounters(int& nb_received, int& nb_queued, int& nb_delivered, int& nb_dropped, int& nb_duplicated);
+    //time spent in each stage (us), p50 and p99 with a 6% resolution
+    void getLatencyStats(LatencyStage stage, int& count, double& mean_us, double& p50_us, double& p99_us, double& max_us);
+    void resetLatencyStats();
+    //timeline of the acquisition threads, dumped as Chrome trace / Perfetto JSON
+    //process wide : the threads of all the cameras are traced and cleared together
+    void setTracing(bool enable);
+    void getTracing(bool& enable);
+    void dumpTrace(const std::string& file_name);
+    //named profiles, kept in memory and saved in the SDK profile files
+    void saveProfile(const std::string& name);
+    //exposure and Lima trigger mode are also kept by CtAcquisition, which writes its own ones at the next prepareAcq :
+    //give it the ones of the camera after applyProfile (the Tango server does it)
+    void applyProfile(const std::string& name);
+    void deleteProfile(const std::string& name);
+    void getProfileNames(std::string& names); // separated by ','
+    void getProfile(const std::string& name, Profile& profile);
+    //last applyProfile : name, duration and nb of settings written to the camera
+    void getProfileSwitch(std::string& name, double& switch_ms, int& nb_writes);
+    //temperature and fan sampled by a background thread, period 0 : no sampling
+    void setTelemetryPeriod(double period);
+    void getTelemetryPeriod(double& period);
+    void getTelemetry(double& timestamp, double& temperature, double& temperature_target, int& fan_speed);
+    void getTelemetryHistory(std::vector<double>& timestamps, std::vector<double>& temperatures, std::vector<int>& fan_speeds);
+    //property reads are cached, the temperature is refreshed periodically
+    void setTemperatureRefresh(double period);
+    void getTemperatureRefresh(double& period);
+    void getPropertyCacheHits(int& nb_hits);
+    void getPropertyCacheMisses(int& nb_misses);
+    //per frame statistics, computed during the copy into the Lima buffer
+    void setFrameStatistics(bool enable);
+    void getFrameStatistics(bool& enable);
+    bool getFrameStats(int frame_nb, FrameStats& stats);
+    void getFrameHistogram(int frame_nb, std::vector<int>& histogram);
+    //exposures (s) cycled frame by frame in internal trigger, written between the software triggers
+    void setExposureSequence(const std::vector<double>& exp_times); // empty : fixed exposure
+    void getExposureSequence(std::vector<double>& exp_times);
+    //exposure of frame_nb (-1 : last frame), false if the frame is not in the last FRAME_STATS_RING_SIZE
+    bool getFrameExposure(int frame_nb, double& exp_time);
     
     bool isAcqRunning() const;
 
@@ -184,8 +345,67 @@ public:
     pthread_cond_t      m_hThdEvent; // TUCAM handle event
     bool                m_signalled;
 private:
-    //read/copy frame
-    bool readFrame(void *bptr, int& frame_nb);
+    //SDK session shared by the Camera objects, called with the session lock
+    void openCamera();
+    void releaseSdk();
+    static std::string readSerialNumber(HDTUCAM hTUCam);
+    //read/copy frame, false if the SDK overwrote it meanwhile
+    bool readFrame(const FrameDesc& frame, void *bptr);
+    //wait for the next frame from the SDK ring, index_gap is the nb of frames missing before it (< 0 if already read)
+    bool waitForFrame(int& index_gap);
+    //acquisition thread, apply the drop policy, false if the acquisition must stop
+    bool handleDroppedFrames(int nb_missing);
+    //grab thread <-> delivery thread
+    bool pushFrame(const FrameDesc& frame);
+    bool waitQueueRoom();
+    void waitDeliveryDone();
+    //attach a Lima frame buffer to the SDK (zero-copy mode)
+    bool attachFrameBuffer(int frame_nb);
+    void detachFrameBuffer();
+    //SDK buffer kept between acquisitions, released only if the geometry changes
+    bool isSdkBufferValid();
+    void releaseSdkBuffer();
+    //measure the delay between TUCAM_Cap_Start and the first trigger accepted by the camera
+    void calibrateArmLatency();
+    //initialization phases, run by the constructor or the init thread
+    void initialize();
+    void endInit(const std::string& error);
+    void coldStart();
+    bool probeArmLatency(int delay_ms);
+    //camera clock -> host clock mapping, fitted on the frames of the acquisition
+    bool readHwTimestamp(double& cam_ts);
+    Timestamp fitHwTimestamp(double cam_ts, const Timestamp& host_ts);
+    //binning factors done by the camera, read from TUIDC_BINNING_SUM/AVG at init
+    void initBinning();
+    void applyBin(const Bin& bin);
+    void computeFrameStats(const FrameDesc& frame, const void* src, void* dst);
+    //exposure of the frame at position in the SDK sequence of the acquisition (received + lost)
+    double sequenceExposure(int position) const;
+    void clearFrameExposures();
+    void recordFrameExposure(int frame_nb, double exp_time);
+    void sampleTelemetry();
+    //properties in m_prop_cache
+    enum CachedProperty
+    {
+        PropExpTime, PropGlobalGain, PropFanSpeed, PropTemperature,
+        PropModel, PropTucamVersion, PropFirmwareVersion, NbCachedProperties
+    };
+    //current settings, from the caches when possible
+    void snapshotProfile(Profile& profile);
+    //depth and binning set by a SDK profile, read back into m_depth, m_bin, m_hw_bin
+    void readBackImageType();
+    void readBackBin();
+    //settings loaded by TUCAM_File_LoadProfiles are read back
+    void loadSdkProfile(const std::string& name);
+    //8, 12 and 16 bits readout modes, read from TUIDC_IMGMODESELECT at init
+    void initImageType();
+    //ROI rounding done by the camera, computed without accessing it
+    void initRoiAlignment();
+    void alignRoi(const Roi& set_roi, Roi& hw_roi);
+    //measure the achieved frame period
+    void updateFramePeriod(const Timestamp& frame_ts);
+    //leave the capture mode started by TUCAM_Cap_Start
+    void stopCapture();
     void setStatus(Camera::Status status, bool force);
     pthread_mutex_t     m_hThdLock;
 
@@ -194,23 +414,45 @@ private:
     //////////////////////////////
 
     class AcqThread;
+    class DeliveryThread;
+    class InitThread;
+    class TelemetryThread;
 
     AcqThread *         m_acq_thread;
+    DeliveryThread *    m_delivery_thread;
+    InitThread *        m_init_thread;
+    mutable Cond        m_init_cond; // signals the end of the initialization
+    std::atomic<bool>   m_init_done;
+    std::string         m_init_error; // empty if the initialization succeeded, written before m_init_done
+    std::vector<double> m_init_timings; // (ms) per InitPhase
+    double              m_init_total; // (ms)
+    TelemetryThread *   m_telemetry_thread;
     TrigMode            m_trigger_mode;
     double              m_exp_time;
     double              m_lat_time;
     ImageType           m_image_type;
     int                 m_nb_frames; // nos of frames to acquire
-    bool                m_thread_running;
-    bool                m_wait_flag;
-    bool                m_quit;
-    int                 m_acq_frame_nb; // nos of frames acquired
+    std::atomic<bool>   m_thread_running;
+    std::atomic<bool>   m_wait_flag; // written under m_cond, read by the grab and delivery threads without it
+    std::atomic<bool>   m_quit;
+    std::atomic<int>    m_acq_frame_nb; // nos of frames acquired (delivered to Lima)
     mutable             Cond m_cond;
     long                m_depth;
-    Camera::Status      m_status;
-    Bin                 m_bin;
+    int                 m_img_mode_12; // TUIDC_IMGMODESELECT value of the 12 bits mode, -1 if none
+    int                 m_img_mode_16; // TUIDC_IMGMODESELECT value used in 8 and 16 bits
+    bool                m_packed12; // SDK frames are 12 bits packed, unpacked during the copy
+    std::vector<unsigned short> m_unpack_buf; // unpacked frame, if it must also be binned
+    std::atomic<Camera::Status> m_status; // read without lock by getStatus
+    Bin                 m_bin; // Lima binning, done by the camera (m_hw_bin) or in the copy (m_sw_bin)
+    Bin                 m_hw_bin;
+    Bin                 m_sw_bin;
+    BinMode             m_bin_mode;
+    std::map<std::pair<int, int>, int> m_hw_bin_values[2]; // per BinMode, bin x/y -> capability value
+    int                 m_sw_bin_offset; // pixels skipped in the SDK frame before the first binned block
+    int                 m_sw_bin_stride; // SDK frame line length (pixels)
+    FrameDim            m_lima_frame_dim; // frame dimension of the Lima buffers of the acquisition
     double              m_temperature_target;
-    bool                m_prepared;
+    bool                m_prepared; // SDK buffer is allocated
     bool                m_cold_start;
     TucamTriggerMode    m_tucam_trigger_mode;
     TucamTriggerEdge    m_tucam_trigger_edge_mode;
@@ -218,12 +460,88 @@ private:
     SoftBufferCtrlObj   m_bufferCtrlObj;
     CSoftTriggerTimer*	m_internal_trigger_timer;
     unsigned short      m_timer_period_ms;
+    std::string         m_camera_id; // index or "sn:" serial number asked at construction
+    int                 m_camera_index; // SDK index of the opened camera, -1 if none
+    std::string         m_serial_number;
+    bool                m_zero_copy; // SDK writes directly into Lima buffers if possible
+    bool                m_zero_copy_active; // zero-copy really used by the current acquisition
+    void*               m_attached_ptr; // Lima buffer currently attached to the SDK
+    int                 m_nb_sdk_buffers; // depth of the SDK frame ring (uiRsdSize)
+    unsigned int        m_next_sdk_index; // index of the next frame to read from the SDK ring
+    FrameQueue          m_frame_queue; // frames grabbed, waiting for delivery to Lima
+    mutable Cond        m_delivery_cond;
+    bool                m_delivery_active; // delivery thread is running an acquisition
+    bool                m_delivery_quit;
+    std::atomic<bool>   m_delivery_waiting; // delivery thread is waiting for a frame
+    std::atomic<bool>   m_grab_done; // no more frames will be pushed
+    std::atomic<bool>   m_delivery_stopped; // Lima asked to stop (newFrameReady returned false)
+    bool                m_grab_waiting; // grab thread is waiting for room in the queue
+    std::atomic<int>    m_grab_frame_nb; // nos of frames queued for delivery (received + blank)
+    Roi                 m_roi; // current hardware roi (full frame if not active)
+    Roi                 m_alloc_roi; // geometry of the allocated SDK buffer
+    RoiAlignment        m_roi_align; // ROI constraints of the camera
+    TUCAM_ROI_ATTR      m_roi_attr; // last ROI written to the camera
+    OutputSignal        m_outputs[NB_OUTPUT_PORTS]; // last output settings read or written
+    bool                m_outputs_valid[NB_OUTPUT_PORTS];
+    std::map<std::string, Profile> m_profiles;
+    std::string         m_profile_name; // last profile applied
+    double              m_profile_switch_ms;
+    int                 m_profile_nb_writes;
+    bool                m_roi_attr_valid; // false if the camera ROI is unknown (init, binning changed)
+    Bin                 m_alloc_bin;
+    long                m_alloc_depth;
+    int                 m_alloc_nb_buffers;
+    int                 m_buffer_cache_hits;
+    int                 m_buffer_cache_misses;
+    double              m_arm_latency; // (ms) after TUCAM_Cap_Start, before the camera accepts triggers
+    Timestamp           m_armed_ts; // when the camera accepts triggers for the current acquisition
+    bool                m_keep_armed; // stay in capture mode between sequences if the trigger config is unchanged
+    bool                m_capturing; // TUCAM_Cap_Start done, TUCAM_Cap_Stop not yet
+    TUCAM_TRIGGER_ATTR  m_capture_trigger; // trigger config of the current capture
+    double              m_period_target; // (s) exp + lat in internal trigger, 0 otherwise
+    int                 m_period_nb;
+    double              m_period_sum;
+    double              m_period_max_error;
+    Timestamp           m_last_frame_ts;
+    std::atomic<unsigned int> m_period_seq; // odd while the frame period statistics are written
+    LatencyHistogram    m_latency[NbLatencyStages]; // per LatencyStage, recorded without lock
+    bool                m_frame_stats; // statistics computed during the copy
+    FrameStatsRing      m_frame_stats_ring; // statistics of the last frames, read without lock
+    std::vector<double> m_exp_sequence; // (s) cycled by the software triggers, empty if the exposure is fixed
+    bool                m_exp_sequence_active; // the camera exposure can differ from m_exp_time
+    std::atomic<int>    m_frame_exp_nb[FRAME_STATS_RING_SIZE]; // frame of the slot, -1 while it is written
+    std::atomic<double> m_frame_exp[FRAME_STATS_RING_SIZE]; // (s) exposure of the last delivered frames
+    std::atomic<int>    m_frame_exp_last; // last frame recorded, -1 if none
+    PropertyCache       m_prop_cache; // CachedProperty values, avoids USB control transfers
+    mutable Cond        m_telemetry_cond; // protects the telemetry samples, wakes up the telemetry thread
+    double              m_telemetry_period; // (s) 0 : no sampling
+    bool                m_telemetry_quit;
+    std::vector<TelemetrySample> m_telemetry_history; // ring of TELEMETRY_HISTORY_SIZE samples
+    int                 m_telemetry_nb; // nb of samples since the start
+    DropPolicy          m_drop_policy;
+    bool                m_sdk_index_valid; // false until the first frame after TUCAM_Cap_Start
+    std::atomic<int>    m_nb_received; // frames received from the SDK, current acquisition
+    std::atomic<int>    m_nb_dropped; // frames missing in the SDK index sequence, current acquisition
+    std::atomic<int>    m_nb_duplicated; // frames received twice, current acquisition
+    std::atomic<int>    m_nb_overwritten; // frames reused by the SDK ring before their copy, current acquisition
+    std::atomic<unsigned int> m_counters_seq; // odd while the counters are reset by startAcq
+    bool                m_hw_timestamp; // TUIDC_ENABLETIMESTAMP, frame timestamps from the frame header
+    Timestamp           m_start_ts; // Lima start timestamp, frame timestamps are relative to it
+    int                 m_ts_nb; // camera/host timestamp pairs in the fit
+    double              m_ts_cam0; // first pair, the fit is done on values relative to it
+    double              m_ts_host0;
+    double              m_ts_mean_x;
+    double              m_ts_mean_y;
+    double              m_ts_cxx;
+    double              m_ts_cxy;
+    double              m_ts_cyy;
+    std::atomic<unsigned int> m_ts_seq; // odd while the fit is written, getTimestampFit retries
 
 } ;
 
 /*******************************************************************
  * \class AcqThread
- * \brief Thread of acquisition
+ * \brief Thread of acquisition, waits for the frames from the SDK and queues them
  *******************************************************************/
 class Camera::AcqThread : public Thread
 {
@@ -239,6 +557,60 @@ private:
     Camera& m_cam;
 } ;
 
+/*******************************************************************
+ * \class TelemetryThread
+ * \brief Thread sampling the temperature and the fan, slowed down during acquisitions
+ *******************************************************************/
+class Camera::TelemetryThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "TelemetryThread");
+public:
+    TelemetryThread(Camera &aCam);
+    virtual ~TelemetryThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
+/*******************************************************************
+ * \class DeliveryThread
+ * \brief Thread copying the queued frames into the Lima buffers
+ *******************************************************************/
+class Camera::DeliveryThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "DeliveryThread");
+public:
+    DeliveryThread(Camera &aCam);
+    virtual ~DeliveryThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
+/*******************************************************************
+ * \class InitThread
+ * \brief Thread running the camera initialization when it is asynchronous
+ *******************************************************************/
+class Camera::InitThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "InitThread");
+public:
+    InitThread(Camera &aCam);
+    virtual ~InitThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
 } // namespace Dhyana
 } // namespace lima
 
@@ -0,0 +1,118 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameQueue.h
+
+#ifndef DHYANAFRAMEQUEUE_H_
+#define DHYANAFRAMEQUEUE_H_
+
+#include <vector>
+#include <atomic>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Timestamp.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct FrameDesc
+ * \brief descriptor of a frame grabbed from the SDK, waiting to be delivered to Lima
+ *******************************************************************/
+struct FrameDesc
+{
+    unsigned char*  data;       // pixels, in the SDK ring or in the attached Lima buffer
+    unsigned char*  slot;       // SDK ring slot (frame header first), NULL if the frame is not in the ring
+    unsigned int    size;       // nb of BYTES
+    unsigned int    sdk_index;  // SDK frame index (m_frame.uiIndex)
+    int             frame_nb;   // Lima acquisition frame number
+    Timestamp       timestamp;  // when the frame was received from the SDK
+    Timestamp       hw_timestamp; // camera timestamp mapped to the host clock, not set if not available
+    unsigned long long received_us; // LatencyHistogram::now() when received, for the delivery latency
+    double          exp_time;   // (s) exposure of the frame, changes with the exposure sequence
+};
+
+/*******************************************************************
+ * \class FrameQueue
+ * \brief bounded lock-free queue, one producer (grab thread) and one consumer (delivery thread)
+ *******************************************************************/
+class LIBDHYANA_API FrameQueue
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameQueue", "Dhyana");
+public:
+    FrameQueue(int capacity = 1);
+
+    //must only be called while producer and consumer are idle
+    void resize(int capacity);
+    void clear();
+
+    //producer side, false if the queue is full
+    bool push(const FrameDesc& frame)
+    {
+        unsigned int tail = m_tail.load(std::memory_order_relaxed);
+        int nb = (int) (tail - m_head.load(std::memory_order_acquire));
+        if (nb >= m_capacity)
+            return false;
+        m_slots[tail & m_mask] = frame;
+        m_tail.store(tail + 1, std::memory_order_release);
+        if (nb + 1 > m_high_water.load(std::memory_order_relaxed))
+            m_high_water.store(nb + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    //consumer side, false if the queue is empty
+    bool pop(FrameDesc& frame)
+    {
+        unsigned int head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        frame = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    int size() const
+    {
+        return (int) (m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+    }
+    bool empty() const { return size() == 0; }
+    int capacity() const { return m_capacity; }
+
+    //highest number of frames waiting in the queue since the last reset
+    int getHighWaterMark() const { return m_high_water.load(std::memory_order_relaxed); }
+    void resetHighWaterMark() { m_high_water.store(0, std::memory_order_relaxed); }
+
+private:
+    std::vector<FrameDesc>      m_slots; // power of 2 size
+    unsigned int                m_mask;
+    int                         m_capacity;
+    alignas(64) std::atomic<unsigned int> m_head; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<unsigned int> m_tail; // next slot to push, written by the producer
+    std::atomic<int>            m_high_water;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMEQUEUE_H_ */
@@ -0,0 +1,101 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameStats.h
+
+#ifndef DHYANAFRAMESTATS_H_
+#define DHYANAFRAMESTATS_H_
+
+#include <atomic>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+const int FRAME_STATS_HIST_BINS = 64;   // histogram of the full pixel range (2^depth)
+const int FRAME_STATS_RING_SIZE = 64;   // nb of frames kept, power of 2
+
+/*******************************************************************
+ * \struct FrameStats
+ * \brief statistics of one frame, computed during the copy into the Lima buffer
+ *******************************************************************/
+struct FrameStats
+{
+    int             frame_nb;       // Lima acquisition frame number, -1 if not set
+    unsigned int    min;
+    unsigned int    max;
+    double          mean;
+    int             nb_saturated;   // pixels at 2^depth - 1 (or more with software binning)
+    unsigned int    histogram[FRAME_STATS_HIST_BINS];
+};
+
+/*******************************************************************
+ * \brief copy 16 bits pixels from src to dst (no copy if dst is NULL) and compute their statistics
+ *
+ * depth is the nb of significant bits (12 or 16), it gives the saturation value and the
+ * histogram bin width. AVX2 or NEON is used if the cpu has it.
+ *******************************************************************/
+LIBDHYANA_API void copyFrameStats16(const unsigned short* src, unsigned short* dst, int nb_pixels,
+                                    int depth, FrameStats& stats);
+
+//same for 8 bits pixels, no SIMD
+LIBDHYANA_API void copyFrameStats8(const unsigned char* src, unsigned char* dst, int nb_pixels,
+                                   FrameStats& stats);
+
+/*******************************************************************
+ * \class FrameStatsRing
+ * \brief statistics of the last frames, one writer (delivery thread), readers never lock
+ *
+ * Each slot has a sequence number, odd while it is written : a reader copies the slot
+ * and retries if the sequence changed during the copy.
+ *******************************************************************/
+class LIBDHYANA_API FrameStatsRing
+{
+public:
+    FrameStatsRing();
+
+    //writer side
+    void clear();
+    void push(const FrameStats& stats);
+
+    //reader side, false if the frame is not (or no more) in the ring
+    bool get(int frame_nb, FrameStats& stats) const;
+    bool getLast(FrameStats& stats) const;
+
+private:
+    bool read(unsigned int slot, FrameStats& stats) const;
+
+    struct Slot
+    {
+        std::atomic<unsigned int>   seq;
+        FrameStats                  stats;
+    };
+    Slot                        m_slots[FRAME_STATS_RING_SIZE];
+    std::atomic<int>            m_last; // frame_nb of the last pushed frame, -1 if none
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMESTATS_H_ */
@@ -0,0 +1,112 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaLatencyHistogram.h
+
+#ifndef DHYANALATENCYHISTOGRAM_H_
+#define DHYANALATENCYHISTOGRAM_H_
+
+#include <atomic>
+#include <time.h>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class LatencyHistogram
+ * \brief HDR style histogram of durations in us, lock-free, can be recorded from several threads
+ *
+ * Values below 32 us have their own bucket, above each power of 2 is split in 16 buckets
+ * (relative error < 6.25%). Values up to 2^37 us (38 hours) are counted.
+ *******************************************************************/
+class LIBDHYANA_API LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(unsigned long long value_us)
+    {
+        m_buckets[bucketOf(value_us)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value_us, std::memory_order_relaxed);
+        unsigned long long max = m_max.load(std::memory_order_relaxed);
+        while (value_us > max && !m_max.compare_exchange_weak(max, value_us, std::memory_order_relaxed))
+            ;
+    }
+    //the values recorded during the reset may be partly lost
+    void reset();
+
+    //percentile 0-100, upper bound of its bucket (us)
+    void getStats(int& count, double& mean_us, double& p50_us, double& p99_us, double& max_us) const;
+    double getPercentile(double percentile) const;
+
+    //monotonic clock (us) to measure the durations
+    static unsigned long long now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+private:
+    enum { SUB_BITS = 5, SUB = 1 << SUB_BITS, HALF = SUB / 2, MAX_SHIFT = 33, NB_BUCKETS = SUB + MAX_SHIFT * HALF };
+
+    static int bucketOf(unsigned long long value)
+    {
+        if (value < SUB)
+            return (int) value;
+        int shift = 63 - __builtin_clzll(value) - (SUB_BITS - 1);
+        if (shift > MAX_SHIFT)
+            return NB_BUCKETS - 1;
+        return SUB + (shift - 1) * HALF + (int) (value >> shift) - HALF;
+    }
+    static unsigned long long bucketMax(int bucket);
+
+    std::atomic<unsigned long long> m_buckets[NB_BUCKETS];
+    std::atomic<unsigned long long> m_count;
+    std::atomic<unsigned long long> m_sum;
+    std::atomic<unsigned long long> m_max;
+} ;
+
+/*******************************************************************
+ * \class LatencyTimer
+ * \brief records in a histogram the time spent in its scope
+ *******************************************************************/
+class LatencyTimer
+{
+public:
+    LatencyTimer(LatencyHistogram& histogram) :
+        m_histogram(histogram), m_start(LatencyHistogram::now()) {}
+    ~LatencyTimer() { m_histogram.record(LatencyHistogram::now() - m_start); }
+
+private:
+    LatencyHistogram&   m_histogram;
+    unsigned long long  m_start;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANALATENCYHISTOGRAM_H_ */
@@ -0,0 +1,88 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaPropertyCache.h
+
+#ifndef DHYANAPROPERTYCACHE_H_
+#define DHYANAPROPERTYCACHE_H_
+
+#include <string>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+#include "lima/Timestamp.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class PropertyCache
+ * \brief last values read from or written to the camera, to avoid USB control transfers
+ *
+ * Each property has a max age : < 0 the value is kept until it is invalidated (static or
+ * only changed by us), 0 it is never cached, > 0 it is read again after max_age seconds.
+ *******************************************************************/
+class LIBDHYANA_API PropertyCache
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "PropertyCache", "Dhyana");
+public:
+    PropertyCache(int nb_properties);
+
+    void setMaxAge(int id, double max_age);
+    void getMaxAge(int id, double& max_age);
+
+    //false (miss) if the value must be read from the camera
+    bool get(int id, double& value);
+    bool get(int id, std::string& value);
+    //value read from or written to the camera
+    void set(int id, double value);
+    void set(int id, const std::string& value);
+    void invalidate(int id);
+    void invalidateAll();
+
+    void getHits(int& nb_hits);
+    void getMisses(int& nb_misses);
+
+private:
+    struct Entry
+    {
+        bool        valid;
+        double      max_age;
+        Timestamp   ts;
+        double      value;
+        std::string text;
+    };
+    bool isFresh(Entry& entry);
+
+    Mutex               m_mutex;
+    std::vector<Entry>  m_entries;
+    int                 m_hits;
+    int                 m_misses;
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAPROPERTYCACHE_H_ */
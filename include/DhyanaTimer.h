@@ -30,11 +30,13 @@
 
 #include <ostream>
 #include <map>
+#include <vector>
+#include <atomic>
 #include <stdio.h>
-#pragma comment(lib, "Winmm.lib" )
 
 #include "DhyanaCompatibility.h"
 #include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
 #include "DhyanaCamera.h"
 
 using namespace std;
@@ -48,70 +50,105 @@ namespace lima
 		class Camera;
 
 		/******************************************************************
-		*
-		*******************************************************************/
-		class CBaseTimer
+		* trigger thread for IntTrig, software triggers are sent at absolute
+		* deadlines (CLOCK_MONOTONIC), one frame period apart, as soon as the
+		* previous frame is read out
+		******************************************************************/
+		class CSoftTriggerTimer : public Thread
 		{
-			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "CBaseTimer");
+			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "CSoftTriggerTimer");
 		public:
-			// ctor
+			//ctor, period is the timeout (ms) after which a trigger with no frame is sent again
 			//------------------------------------------------------------
-			CBaseTimer(int period = 1000);
+			CSoftTriggerTimer(int period, Camera& cam);
 
-			// dtor
+			//dtor
 			//------------------------------------------------------------
-			~CBaseTimer();
+			virtual ~CSoftTriggerTimer();
 
+			//frame_period and first_delay in seconds
 			//------------------------------------------------------------
-			static void  base_timer_proc(union sigval dwUser)
-			{
-				//std::cout<<" ----> base_timer_proc <------- [BEGIN]"<<std::endl;
-				CBaseTimer* pThis = (CBaseTimer*)dwUser.sival_ptr;
-				pThis->on_timer();
-				//std::cout<<" ----> base_timer_proc <------- [END]"<<std::endl;
-			}
+			void start(double frame_period, double first_delay);
+			void stop();
 
+			//exposures (s) cycled by the next start, written before each trigger,
+			//the frame period is then the exposure of the frame + lat_time. empty : disabled
 			//------------------------------------------------------------
-			void start();
+			void setExposureSequence(const std::vector<double>& exp_times, double lat_time);
 
+			//called by the acquisition thread for each frame received from the SDK
 			//------------------------------------------------------------
-			void stop();
+			void frameGrabbed();
 
+			//wake up delay of the trigger deadlines (us), since start, triggers delayed by the readout excluded
 			//------------------------------------------------------------
-			virtual void on_timer() = 0;
+			void getJitter(double& mean_us, double& std_us, double& max_us);
 
 		protected:
-			timer_t m_timer_id;
-			long m_period_ms;
-			struct sigevent m_se;
-			struct itimerspec m_ts;
-			struct itimerspec m_ts_reset;
+			virtual void threadFunction();
+
+		private:
+			bool sleepUntil(const struct timespec& deadline, int generation);
+			double triggerPeriod(int trigger) const;
+			void writeExposure(int trigger);
+			//SDK calls are done without the mutex, frameGrabbed never waits for a USB transfer
+			void beginSdkCall();
+			void endSdkCall();
+
+			Camera& m_cam;
+			Cond m_cond;
+			bool m_active;
+			bool m_quit;
+			int  m_generation; // incremented by each start(), a stopped sequence must not trigger the next one
+			long m_retrigger_ms;
+			double m_frame_period;
+			double m_first_delay;
+			int  m_nb_frames;
+			int  m_nb_triggers;
+			int  m_nb_grabbed;
+			int  m_nb_retriggers;
+			long m_nb_jitter;
+			double m_jitter_sum;
+			double m_jitter_sum2;
+			double m_jitter_max;
+			int  m_nb_late; // triggers sent after their deadline because the readout was late
+			std::vector<double> m_exp_sequence; // (s) empty if the exposure is fixed
+			double m_seq_lat_time; // (s) added to the exposures of m_exp_sequence
+			double m_exp_written; // (s) last exposure written by the sequence, -1 if none
+			bool m_sdk_busy; // trigger or exposure write in progress, stop() waits for its end
 		};
 
 		/******************************************************************
-		*
+		* one shot watchdog, unblocks TUCAM_Buf_WaitForFrame after period.
+		* the thread is joined by the dtor, no abort after stop() returns
 		******************************************************************/
-		class CSoftTriggerTimer : public CBaseTimer
+		class CAbortWaitTimer : public Thread
 		{
-			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "CSoftTriggerTimer");
+			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "CAbortWaitTimer");
 		public:
-			//ctor
+			//ctor, period in ms
 			//------------------------------------------------------------
-			CSoftTriggerTimer(int period, Camera& cam);
+			CAbortWaitTimer(int period, Camera& cam);
 
 			//dtor
 			//------------------------------------------------------------
-			~CSoftTriggerTimer();
+			virtual ~CAbortWaitTimer();
 
 			//------------------------------------------------------------
 			void start();
 			void stop();
-			void on_timer();
+			bool hasFired() const {return m_fired;}
+
+		protected:
+			virtual void threadFunction();
 
 		private:
 			Camera& m_cam;
-			int  m_nb_frames;
-			int  m_nb_triggers;
+			Cond m_cond;
+			long m_period_ms;
+			bool m_armed;
+			bool m_quit;
+			std::atomic<bool> m_fired;
 		};
 
 	} // namespace Dhyana
@@ -0,0 +1,108 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaTrace.h
+
+#ifndef DHYANATRACE_H_
+#define DHYANATRACE_H_
+
+#include <atomic>
+#include <ostream>
+#include <time.h>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class Trace
+ * \brief optional timeline of the acquisition threads, dumped in the Chrome trace event format
+ *
+ * Begin/end events are written without lock in a ring owned by the calling thread (allocated at
+ * its first event), the oldest events are overwritten. Nothing is recorded while tracing is disabled.
+ * The ring of a thread which exits is kept until the next clear for the dump, then freed.
+ * The event names are kept as pointers, they must be string literals.
+ *
+ * The tracing covers the whole process : with several cameras, enabling or clearing it from one
+ * camera clears the events of the other ones too, and a dump contains the threads of all of them.
+ *******************************************************************/
+class LIBDHYANA_API Trace
+{
+public:
+    enum { RING_SIZE = 1 << 14 };   // events kept per thread
+
+    //enabling the tracing clears the events of the previous one
+    static void setEnabled(bool enable);
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    //name of the calling thread in the timeline
+    static void setThreadName(const char* name);
+
+    static void begin(const char* name) { if (isEnabled()) record(name, 'B'); }
+    static void end(const char* name) { if (isEnabled()) record(name, 'E'); }
+    static void instant(const char* name) { if (isEnabled()) record(name, 'i'); }
+    static void record(const char* name, char phase);
+
+    //JSON for chrome://tracing or Perfetto, events being written during the dump may be skipped
+    static void dump(std::ostream& os);
+    static void clear();
+
+    //monotonic clock (ns)
+    static unsigned long long now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+private:
+    static std::atomic<bool> s_enabled;
+} ;
+
+/*******************************************************************
+ * \class TraceScope
+ * \brief begin and end events around its scope
+ *******************************************************************/
+class TraceScope
+{
+public:
+    TraceScope(const char* name) : m_name(Trace::isEnabled() ? name : NULL)
+    {
+        if (m_name)
+            Trace::record(m_name, 'B');
+    }
+    ~TraceScope()
+    {
+        if (m_name)
+            Trace::record(m_name, 'E');
+    }
+
+private:
+    const char* m_name;     // NULL if the tracing was disabled at the beginning
+} ;
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANATRACE_H_ */
@@ -0,0 +1,46 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaUnpack.h
+
+#ifndef DHYANAUNPACK_H_
+#define DHYANAUNPACK_H_
+
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \brief unpack 12 bits pixels, 2 pixels in 3 bytes, into 16 bits pixels
+ *
+ * byte 0 : bits 0-7 of pixel 0, byte 1 : bits 8-11 of pixel 0 and bits 0-3 of pixel 1,
+ * byte 2 : bits 4-11 of pixel 1.
+ *******************************************************************/
+LIBDHYANA_API void unpack12(const unsigned char* src, unsigned short* dst, int nb_pixels);
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAUNPACK_H_ */
@@ -0,0 +1,408 @@
+// Acquisition benchmark : sweeps exposure, roi, trigger mode, nb of frames and SDK buffers,
+// and reports throughput, delivery latency, start/stop overhead and cpu usage as JSON or CSV.
+// Runs against a camera or the simulated TUCam library (-DDHYANA_MOCK_SDK=ON).
+//
+// dhyanabench --exposure 0.001,0.01 --roi full,1024x1024 --trigger IntTrig --frames 100,1000
+//             --buffers 1,4 --repeat 3 --format csv --output results.csv
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <mutex>
+#include <condition_variable>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <DhyanaCamera.h>
+#include <DhyanaInterface.h>
+#include <lima/CtControl.h>
+#include <lima/CtImage.h>
+#include <lima/CtAcquisition.h>
+
+using namespace lima::Dhyana;
+using namespace lima;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Config
+{
+    double exposure;
+    std::string roi;        // "full" or "WxH", centered
+    std::string trigger;
+    int nb_frames;
+    int nb_buffers;
+    double latency;
+    bool zero_copy;
+};
+
+struct Result
+{
+    Config config;
+    int repeat;
+    std::string status;     // ok, timeout or the error
+    int nb_acquired;
+    int nb_dropped;
+    int queue_high_water;
+    double prepare_ms;
+    double start_ms;        // ct.startAcq()
+    double first_frame_ms;  // from startAcq to the first frame
+    double stop_ms;         // from the last frame to the Ready status
+    double fps;             // sustained, between the first and the last frame
+    double cpu_percent;     // user + system of the whole process, 100 = one core
+    double delivery_p50_us, delivery_p99_us, delivery_max_us;
+    double copy_p50_us, copy_p99_us;
+    double period_p50_us, period_p99_us, period_max_us;
+};
+
+//time of the first and last frames seen by the image status callback
+class FrameWatcher : public CtControl::ImageStatusCallback
+{
+public:
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_last = -1;
+    }
+
+    //wait until frame nb is acquired or the timeout, return the last frame acquired
+    int wait(int nb, Clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_last < nb && Clock::now() < deadline)
+            m_cond.wait_until(lock, deadline);
+        return m_last;
+    }
+
+    int m_first;            // first frame seen, the callback can skip frames
+    Clock::time_point m_first_time;
+    Clock::time_point m_last_time;
+
+protected:
+    virtual void imageStatusChanged(const CtControl::ImageStatus& status)
+    {
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (status.LastImageAcquired <= m_last)
+            return;
+        if (m_last < 0)
+        {
+            m_first = status.LastImageAcquired;
+            m_first_time = now;
+        }
+        m_last = status.LastImageAcquired;
+        m_last_time = now;
+        m_cond.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    int m_last = -1;
+};
+
+static double ms(Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static double cpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+static std::vector<std::string> split(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static TrigMode trigMode(const std::string& name)
+{
+    if (name == "IntTrig") return IntTrig;
+    if (name == "IntTrigMult") return IntTrigMult;
+    if (name == "ExtTrigSingle") return ExtTrigSingle;
+    if (name == "ExtTrigMult") return ExtTrigMult;
+    if (name == "ExtGate") return ExtGate;
+    throw std::invalid_argument("unknown trigger mode " + name);
+}
+
+static Roi centeredRoi(const std::string& roi, const Size& size)
+{
+    int width, height;
+    if (roi == "full" || sscanf(roi.c_str(), "%dx%d", &width, &height) != 2)
+        return Roi(0, 0, size.getWidth(), size.getHeight());
+    return Roi((size.getWidth() - width) / 2, (size.getHeight() - height) / 2, width, height);
+}
+
+static Result run(CtControl& ct, Camera& cam, FrameWatcher& watcher, const Config& config, int repeat, double timeout)
+{
+    Result res = Result();
+    res.config = config;
+    res.repeat = repeat;
+    res.status = "ok";
+
+    try
+    {
+        Size size;
+        cam.getDetectorImageSize(size);
+        cam.setNbSdkBuffers(config.nb_buffers);
+        cam.setZeroCopy(config.zero_copy);
+        cam.resetLatencyStats();
+
+        CtAcquisition* acq = ct.acquisition();
+        acq->setAcqMode(Single);
+        acq->setTriggerMode(trigMode(config.trigger));
+        acq->setAcqExpoTime(config.exposure);
+        acq->setLatencyTime(config.latency);
+        acq->setAcqNbFrames(config.nb_frames);
+        ct.image()->setRoi(centeredRoi(config.roi, size));
+        watcher.reset();
+
+        double cpu0 = cpuSeconds();
+        Clock::time_point t0 = Clock::now();
+        ct.prepareAcq();
+        Clock::time_point t1 = Clock::now();
+        ct.startAcq();
+        Clock::time_point t2 = Clock::now();
+        res.prepare_ms = ms(t1 - t0);
+        res.start_ms = ms(t2 - t1);
+
+        //no frame during the timeout means the run is stuck (no trigger in external modes)
+        Clock::time_point deadline = t2 + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(timeout + config.nb_frames * (config.exposure + config.latency)));
+        int last = watcher.wait(config.nb_frames - 1, deadline);
+        res.nb_acquired = last + 1;
+        if (last < config.nb_frames - 1)
+        {
+            res.status = "timeout";
+            ct.stopAcq();
+        }
+
+        //the acquisition is over when the status is back to Ready
+        CtControl::Status status;
+        do
+        {
+            ct.getStatus(status);
+            if (status.AcquisitionStatus == AcqRunning)
+                usleep(500);
+        } while (status.AcquisitionStatus == AcqRunning && Clock::now() < deadline + std::chrono::seconds(5));
+        Clock::time_point t3 = Clock::now();
+        double cpu1 = cpuSeconds();
+        if (status.AcquisitionStatus == AcqFault && res.status == "ok")
+            res.status = "fault";
+
+        if (res.nb_acquired > 0)
+        {
+            res.first_frame_ms = ms(watcher.m_first_time - t1);
+            res.stop_ms = ms(t3 - watcher.m_last_time);
+        }
+        if (last > watcher.m_first)
+            res.fps = (last - watcher.m_first) / (ms(watcher.m_last_time - watcher.m_first_time) / 1000.);
+        res.cpu_percent = 100. * (cpu1 - cpu0) / (ms(t3 - t0) / 1000.);
+
+        int count;
+        double mean, max;
+        cam.getLatencyStats(Camera::StageDelivery, count, mean, res.delivery_p50_us, res.delivery_p99_us, res.delivery_max_us);
+        cam.getLatencyStats(Camera::StageCopy, count, mean, res.copy_p50_us, res.copy_p99_us, max);
+        cam.getLatencyStats(Camera::StageFramePeriod, count, mean, res.period_p50_us, res.period_p99_us, res.period_max_us);
+        cam.getDroppedFrames(res.nb_dropped);
+        cam.getQueueHighWaterMark(res.queue_high_water);
+    }
+    catch (Exception& e)
+    {
+        res.status = e.getErrMsg();
+        try { ct.stopAcq(); } catch (...) {}
+    }
+    catch (const std::exception& e)
+    {
+        res.status = e.what();
+        try { ct.stopAcq(); } catch (...) {}
+    }
+    return res;
+}
+
+static std::string quote(const std::string& s)
+{
+    std::string q = "\"";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        char c = s[i];
+        if (c == '"' || c == '\\')
+            q += '\\';
+        if (c == '\n')
+            q += "\\n";
+        else
+            q += c;
+    }
+    return q + "\"";
+}
+
+//name and value of each column, in the same order for JSON and CSV
+static std::vector<std::pair<std::string, std::string> > fields(const Result& r)
+{
+    std::vector<std::pair<std::string, std::string> > f;
+    std::ostringstream v;
+#define FIELD(name, value) v.str(""); v << value; f.push_back(std::make_pair(std::string(name), v.str()))
+    FIELD("exposure", r.config.exposure);
+    FIELD("roi", quote(r.config.roi));
+    FIELD("trigger", quote(r.config.trigger));
+    FIELD("nb_frames", r.config.nb_frames);
+    FIELD("nb_buffers", r.config.nb_buffers);
+    FIELD("latency", r.config.latency);
+    FIELD("zero_copy", (r.config.zero_copy ? "true" : "false"));
+    FIELD("repeat", r.repeat);
+    FIELD("status", quote(r.status));
+    FIELD("nb_acquired", r.nb_acquired);
+    FIELD("nb_dropped", r.nb_dropped);
+    FIELD("queue_high_water", r.queue_high_water);
+    FIELD("prepare_ms", r.prepare_ms);
+    FIELD("start_ms", r.start_ms);
+    FIELD("first_frame_ms", r.first_frame_ms);
+    FIELD("stop_ms", r.stop_ms);
+    FIELD("fps", r.fps);
+    FIELD("cpu_percent", r.cpu_percent);
+    FIELD("delivery_p50_us", r.delivery_p50_us);
+    FIELD("delivery_p99_us", r.delivery_p99_us);
+    FIELD("delivery_max_us", r.delivery_max_us);
+    FIELD("copy_p50_us", r.copy_p50_us);
+    FIELD("copy_p99_us", r.copy_p99_us);
+    FIELD("period_p50_us", r.period_p50_us);
+    FIELD("period_p99_us", r.period_p99_us);
+    FIELD("period_max_us", r.period_max_us);
+#undef FIELD
+    return f;
+}
+
+static void usage()
+{
+    std::cerr << "usage: dhyanabench [--exposure s,...] [--roi full|WxH,...] [--trigger IntTrig|ExtTrigSingle|ExtTrigMult|ExtGate,...]\n"
+              << "                   [--frames n,...] [--buffers n,...] [--latency s] [--zero-copy] [--repeat n]\n"
+              << "                   [--timeout s] [--format json|csv] [--output file]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> exposures(1, "0.01"), rois(1, "full"), triggers(1, "IntTrig");
+    std::vector<std::string> frames(1, "100"), buffers(1, "4");
+    double latency = 0, timeout = 5;
+    bool zero_copy = false;
+    int nb_repeat = 1;
+    std::string format = "json", output;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--zero-copy")
+        {
+            zero_copy = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--exposure") exposures = split(value);
+        else if (arg == "--roi") rois = split(value);
+        else if (arg == "--trigger") triggers = split(value);
+        else if (arg == "--frames") frames = split(value);
+        else if (arg == "--buffers") buffers = split(value);
+        else if (arg == "--latency") latency = atof(value.c_str());
+        else if (arg == "--repeat") nb_repeat = atoi(value.c_str());
+        else if (arg == "--timeout") timeout = atof(value.c_str());
+        else if (arg == "--format") format = value;
+        else if (arg == "--output") output = value;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    Camera cam(999);
+    Interface hw(cam);
+    CtControl ct(&hw);
+    FrameWatcher watcher;
+    ct.registerImageStatusCallback(watcher);
+
+    std::string model, sdk_version, firmware_version;
+    cam.getDetectorModel(model);
+    cam.getTucamVersion(sdk_version);
+    cam.getFirmwareVersion(firmware_version);
+
+    std::ofstream file;
+    if (!output.empty())
+        file.open(output.c_str());
+    std::ostream& out = output.empty() ? std::cout : file;
+
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    if (format == "json")
+        out << "{\n  \"model\": " << quote(model) << ",\n  \"sdk_version\": " << quote(sdk_version)
+            << ",\n  \"firmware_version\": " << quote(firmware_version) << ",\n  \"date\": " << quote(date)
+            << ",\n  \"runs\": [";
+
+    bool first = true;
+    for (size_t e = 0; e < exposures.size(); e++)
+    for (size_t r = 0; r < rois.size(); r++)
+    for (size_t t = 0; t < triggers.size(); t++)
+    for (size_t f = 0; f < frames.size(); f++)
+    for (size_t b = 0; b < buffers.size(); b++)
+    for (int n = 0; n < nb_repeat; n++)
+    {
+        Config config;
+        config.exposure = atof(exposures[e].c_str());
+        config.roi = rois[r];
+        config.trigger = triggers[t];
+        config.nb_frames = atoi(frames[f].c_str());
+        config.nb_buffers = atoi(buffers[b].c_str());
+        config.latency = latency;
+        config.zero_copy = zero_copy;
+        Result res = run(ct, cam, watcher, config, n, timeout);
+        std::vector<std::pair<std::string, std::string> > values = fields(res);
+
+        if (format == "csv")
+        {
+            if (first)
+            {
+                out << "model,sdk_version,date";
+                for (size_t i = 0; i < values.size(); i++)
+                    out << "," << values[i].first;
+                out << "\n";
+            }
+            out << quote(model) << "," << quote(sdk_version) << "," << date;
+            for (size_t i = 0; i < values.size(); i++)
+                out << "," << values[i].second;
+            out << std::endl;
+        }
+        else
+        {
+            out << (first ? "\n    {" : ",\n    {");
+            for (size_t i = 0; i < values.size(); i++)
+                out << (i ? ", " : "") << "\"" << values[i].first << "\": " << values[i].second;
+            out << "}" << std::flush;
+        }
+        first = false;
+        std::cerr << config.exposure << " s " << config.roi << " " << config.trigger << " " << config.nb_frames
+                  << " frames " << config.nb_buffers << " buffers : " << res.status << ", " << res.fps << " fps" << std::endl;
+    }
+
+    if (format == "json")
+        out << "\n  ]\n}" << std::endl;
+    ct.unregisterImageStatusCallback(watcher);
+    return 0;
+}
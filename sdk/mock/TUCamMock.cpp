@@ -0,0 +1,1123 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// TUCamMock.cpp
+// Simulated TUCam library : the subset of TUCamApi.h used by the Dhyana plugin,
+// with synthetic frames produced at the rate of a rolling shutter sensor model.
+//
+// The timing model is read from the environment at TUCAM_Api_Init :
+//   TUCAM_MOCK_NB_CAMERAS      nb of simulated cameras (1)
+//   TUCAM_MOCK_WIDTH/HEIGHT    sensor size in pixels (2048 x 2048)
+//   TUCAM_MOCK_LINE_TIME_US    readout time of one sensor line (20 us, 24 fps full frame)
+//   TUCAM_MOCK_USB_MBPS        transfer rate limit in MB/s, 0 for no limit (350)
+//   TUCAM_MOCK_ARM_US          triggers sent earlier than this after TUCAM_Cap_Start are lost (0)
+//   TUCAM_MOCK_EXT_TRIGGER_HZ  rate of the simulated trigger input in external modes, 0 for none (0)
+//   TUCAM_MOCK_DROP_EVERY      every nth frame is lost on the bus, 0 for none (0)
+//   TUCAM_MOCK_PACKED12        12 bits frames are packed, 3 bytes for 2 pixels (0)
+//   TUCAM_MOCK_PATTERN         "ramp", "noise" or "none" to leave the pixels untouched (ramp)
+//   TUCAM_MOCK_COOLING_S       time constant of the sensor temperature (30 s)
+// Camera i reports the serial number MOCK000i.
+// Profiles are kept in memory, shared by the cameras of the process.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "TUCamApi.h"
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+
+const double TEMPERATURE_AMBIENT = 25.;	// sensor temperature when the cooling starts
+const int TEMPERATURE_MIDDLE = 50;		// TUIDP_TEMPERATURE is written as target + middle
+
+struct MockConfig
+{
+	int nb_cameras;
+	int width;
+	int height;
+	double line_time_us;
+	double usb_mbps;
+	double arm_us;
+	double ext_trigger_hz;
+	int drop_every;
+	bool packed12;
+	std::string pattern;
+	double cooling_s;
+};
+
+MockConfig g_config;
+bool g_initialized = false;
+
+double envDouble(const char* name, double dft)
+{
+	const char* value = getenv(name);
+	return (value && *value) ? atof(value) : dft;
+}
+
+std::string envString(const char* name, const char* dft)
+{
+	const char* value = getenv(name);
+	return (value && *value) ? value : dft;
+}
+
+struct Capability
+{
+	int min, max, dft, value;
+	std::vector<std::string> texts;	// text of each value from min, empty if the value is its own text
+};
+
+struct Property
+{
+	double min, max, dft, step, value;
+};
+
+//-----------------------------------------------------
+// @brief one slot of the frame ring, the frame is either in the slot or in an attached user buffer
+//-----------------------------------------------------
+struct Slot
+{
+	long long index;		// frame index, -1 if empty
+	unsigned char* data;		// pixels
+	bool in_ring;			// false if data is an attached user buffer (no header)
+	std::vector<unsigned char> buffer;
+};
+
+} // namespace
+
+//-----------------------------------------------------
+// @brief a simulated camera, HDTUCAM points to it
+//-----------------------------------------------------
+struct _tagTUCAM
+{
+	int idx;
+	std::map<int, Capability> capas;
+	std::map<int, Property> props;
+	TUCAM_ROI_ATTR roi;
+	TUCAM_TRIGGER_ATTR trigger;
+	TUCAM_TRGOUT_ATTR trgout[3];
+	char model[64];
+	char version_api[32];
+	char version_frmw[32];
+	char serial[TUSIZE_SN];
+
+	//sensor temperature relaxes from temp0 at temp_t0 to the target
+	double temp0;
+	Clock::time_point temp_t0;
+
+	std::mutex mutex;
+	std::condition_variable cond;	// frame published, capture started/stopped, abort
+	std::thread generator;
+	bool quit;
+
+	//frame ring allocated by TUCAM_Buf_Alloc
+	std::vector<Slot> slots;
+	TUCAM_FRAME geometry;		// frame description returned by the wait functions
+	int bin;
+	int depth;			// 8, 12 or 16
+	long long next_index;		// index of the next frame produced
+	long long newest;		// index of the last frame published, -1 if none
+	long long read_next;		// next frame returned by TUCAM_Buf_WaitForFrame
+	unsigned char* attached;	// user buffer for the next frame
+	unsigned int attached_size;
+	bool filling;			// the generator writes pixels without the lock
+	unsigned int abort_gen;
+
+	//capture
+	bool capturing;
+	unsigned int capture_gen;	// changes at each TUCAM_Cap_Start / TUCAM_Cap_Stop
+	unsigned int mode;		// TUCAM_CAPTURE_MODES
+	Clock::time_point start_time;
+	Clock::time_point armed_time;
+	int burst_size;			// frames acquired for each accepted trigger
+	int burst_left;			// frames still to acquire for the accepted trigger
+	bool busy;			// a triggered burst is in progress, new triggers are lost
+	Clock::time_point trigger_time;
+	unsigned long long lost_triggers;
+	unsigned int seed;
+};
+
+namespace
+{
+
+//-----------------------------------------------------
+// @brief binning factor from TUIDC_BINNING_SUM / TUIDC_BINNING_AVG, the values are 1x1, 2x2, 4x4
+//-----------------------------------------------------
+int binFactor(_tagTUCAM* cam)
+{
+	int value = std::max(cam->capas[TUIDC_BINNING_SUM].value, cam->capas[TUIDC_BINNING_AVG].value);
+	return 1 << value;
+}
+
+int imageDepth(_tagTUCAM* cam)
+{
+	const Capability& mode = cam->capas[TUIDC_IMGMODESELECT];
+	if (mode.texts[mode.value - mode.min].find("12") != std::string::npos)
+		return 12;
+	return (cam->capas[TUIDC_BITOFDEPTH].value == 8) ? 8 : 16;
+}
+
+double exposureUs(_tagTUCAM* cam)
+{
+	return cam->props[TUIDP_EXPOSURETM].value * 1000.;
+}
+
+//-----------------------------------------------------
+// @brief rolling readout of the sensor lines of the roi, or transfer time if the bus is slower
+//-----------------------------------------------------
+double readoutUs(_tagTUCAM* cam)
+{
+	double lines = (double) cam->geometry.usHeight * cam->bin;
+	double readout = lines * g_config.line_time_us;
+	if (g_config.usb_mbps > 0)
+		readout = std::max(readout, cam->geometry.uiImgSize / g_config.usb_mbps);
+	return readout;
+}
+
+double temperature(_tagTUCAM* cam)
+{
+	double target = cam->props[TUIDP_TEMPERATURE].value - TEMPERATURE_MIDDLE;
+	double elapsed = std::chrono::duration<double>(Clock::now() - cam->temp_t0).count();
+	return target + (cam->temp0 - target) * exp(-elapsed / g_config.cooling_s);
+}
+
+void initCamera(_tagTUCAM* cam, int idx)
+{
+	cam->idx = idx;
+	Capability bits = {8, 16, 16, 16};
+	cam->capas[TUIDC_BITOFDEPTH] = bits;
+	Capability img_mode = {0, 3, 1, 1};
+	const char* img_modes[] = {"CMS", "HDR", "HighSpeed", "12Bit"};
+	img_mode.texts.assign(img_modes, img_modes + 4);
+	cam->capas[TUIDC_IMGMODESELECT] = img_mode;
+	Capability binning = {0, 2, 0, 0};
+	const char* bin_texts[] = {"1x1", "2x2", "4x4"};
+	binning.texts.assign(bin_texts, bin_texts + 3);
+	cam->capas[TUIDC_BINNING_SUM] = binning;
+	cam->capas[TUIDC_BINNING_AVG] = binning;
+	Capability fan = {0, 3, 0, 0};
+	cam->capas[TUIDC_FAN_GEAR] = fan;
+	Capability timestamp = {0, 1, 0, 0};
+	cam->capas[TUIDC_ENABLETIMESTAMP] = timestamp;
+
+	Property gain = {0, 2, 1, 1, 1};
+	cam->props[TUIDP_GLOBALGAIN] = gain;
+	Property exposure = {0.0, 3600000., 10., 0.001, 10.};
+	cam->props[TUIDP_EXPOSURETM] = exposure;
+	Property temp = {0, 100, TEMPERATURE_MIDDLE, 1, TEMPERATURE_MIDDLE};
+	cam->props[TUIDP_TEMPERATURE] = temp;
+
+	cam->roi.bEnable = false;
+	cam->roi.nHOffset = cam->roi.nVOffset = 0;
+	cam->roi.nWidth = g_config.width;
+	cam->roi.nHeight = g_config.height;
+	cam->trigger.nTgrMode = TUCCM_SEQUENCE;
+	cam->trigger.nExpMode = TUCTE_EXPTM;
+	cam->trigger.nEdgeMode = TUCTD_RISING;
+	cam->trigger.nDelayTm = 0;
+	cam->trigger.nFrames = 1;
+	const int trgout_modes[3] = {TUOPT_EXPSTART, TUOPT_EXPGLOBAL, TUOPT_READEND};
+	for (int port = 0; port < 3; port++)
+	{
+		cam->trgout[port].nTgrOutPort = port;
+		cam->trgout[port].nTgrOutMode = trgout_modes[port];
+		cam->trgout[port].nEdgeMode = TUOPT_RISING;
+		cam->trgout[port].nDelayTm = 0;
+		cam->trgout[port].nWidth = 5000;
+	}
+
+	snprintf(cam->model, sizeof(cam->model), "Dhyana 95 (simulated #%d)", idx);
+	snprintf(cam->version_api, sizeof(cam->version_api), "1.0.0.0-mock");
+	snprintf(cam->version_frmw, sizeof(cam->version_frmw), "0x%x", 0x1000 + idx);
+	snprintf(cam->serial, sizeof(cam->serial), "MOCK%04d", idx);
+
+	cam->temp0 = TEMPERATURE_AMBIENT;
+	cam->temp_t0 = Clock::now();
+	cam->quit = false;
+	memset(&cam->geometry, 0, sizeof(cam->geometry));
+	cam->bin = 1;
+	cam->depth = 16;
+	cam->next_index = 0;
+	cam->newest = -1;
+	cam->read_next = 0;
+	cam->attached = NULL;
+	cam->attached_size = 0;
+	cam->filling = false;
+	cam->abort_gen = 0;
+	cam->capturing = false;
+	cam->capture_gen = 0;
+	cam->mode = TUCCM_SEQUENCE;
+	cam->burst_size = 1;
+	cam->burst_left = 0;
+	cam->busy = false;
+	cam->lost_triggers = 0;
+	cam->seed = 2463534242u + idx;
+}
+
+//-----------------------------------------------------
+// @brief synthetic pixels : a ramp moving with the frame index, or noise
+//-----------------------------------------------------
+void fillPixels(_tagTUCAM* cam, unsigned char* data, long long index)
+{
+	const TUCAM_FRAME& g = cam->geometry;
+	if (g_config.pattern == "none")
+		return;
+	bool noise = (g_config.pattern == "noise");
+	unsigned int mask = (1u << cam->depth) - 1;
+	unsigned int s = cam->seed;
+	for (int y = 0; y < g.usHeight; y++)
+	{
+		unsigned char* line = data + (size_t) y * g.uiWidthStep;
+		for (int x = 0; x < g.usWidth; x++)
+		{
+			unsigned int value;
+			if (noise)
+			{
+				s ^= s << 13;
+				s ^= s >> 17;
+				s ^= s << 5;
+				value = s & mask;
+			}
+			else
+			{
+				value = (unsigned int) (x + y + index) & mask;
+			}
+			if (g.ucElemBytes == 2)
+				((unsigned short*) line)[x] = (unsigned short) value;
+			else if (cam->depth == 8)
+				line[x] = (unsigned char) value;
+			else if (x & 1)
+			{
+				//packed 12 bits, 2 pixels in 3 bytes, low nibble first
+				unsigned char* p = line + 3 * (x / 2);
+				p[1] = (p[1] & 0x0f) | ((value & 0x0f) << 4);
+				p[2] = (unsigned char) (value >> 4);
+			}
+			else
+			{
+				unsigned char* p = line + 3 * (x / 2);
+				p[0] = (unsigned char) value;
+				p[1] = (unsigned char) (value >> 8);
+			}
+		}
+	}
+	cam->seed = s;
+}
+
+void fillHeader(_tagTUCAM* cam, unsigned char* slot, long long index, Clock::time_point now)
+{
+	TUCAM_IMG_HEADER* header = (TUCAM_IMG_HEADER*) slot;
+	memset(header, 0, sizeof(TUCAM_IMG_HEADER));
+	memcpy(header->szSignature, cam->geometry.szSignature, sizeof(header->szSignature));
+	header->usHeader = cam->geometry.usHeader;
+	header->usOffset = cam->geometry.usOffset;
+	header->usWidth = cam->geometry.usWidth;
+	header->usHeight = cam->geometry.usHeight;
+	header->uiWidthStep = cam->geometry.uiWidthStep;
+	header->ucDepth = cam->geometry.ucDepth;
+	header->ucFormat = cam->geometry.ucFormat;
+	header->ucChannels = 1;
+	header->ucElemBytes = cam->geometry.ucElemBytes;
+	header->uiIndex = (UINT32) index;
+	header->uiImgSize = cam->geometry.uiImgSize;
+	header->dblExposure = cam->props[TUIDP_EXPOSURETM].value;
+	//camera clock in ms since TUCAM_Cap_Start, only if the time stamp is enabled
+	if (cam->capas[TUIDC_ENABLETIMESTAMP].value)
+		header->dblTimeStamp = std::chrono::duration<double, std::milli>(now - cam->start_time).count();
+}
+
+//-----------------------------------------------------
+// @brief accept a trigger if the sensor is idle and armed, mutex must be locked
+//-----------------------------------------------------
+void acceptTrigger(_tagTUCAM* cam, Clock::time_point now)
+{
+	if (!cam->capturing || cam->mode == TUCCM_SEQUENCE)
+		return;
+	if (cam->busy || now < cam->armed_time)
+	{
+		cam->lost_triggers++;
+		return;
+	}
+	cam->busy = true;
+	cam->burst_size = std::max(1, (int) cam->trigger.nFrames);
+	cam->burst_left = cam->burst_size;
+	cam->trigger_time = now + std::chrono::microseconds(std::max(0, (int) cam->trigger.nDelayTm));
+	cam->cond.notify_all();
+}
+
+//-----------------------------------------------------
+// @brief sensor thread : exposes, reads out and publishes the frames in the ring
+//-----------------------------------------------------
+void generatorThread(_tagTUCAM* cam)
+{
+	std::unique_lock<std::mutex> lock(cam->mutex);
+	Clock::time_point next_ext_trigger;
+	Clock::time_point last_done;
+	unsigned int gen = ~0u;
+
+	while (!cam->quit)
+	{
+		if (!cam->capturing)
+		{
+			cam->cond.wait(lock);
+			continue;
+		}
+		if (gen != cam->capture_gen)
+		{
+			//new capture, the first frame is exposed from the start
+			gen = cam->capture_gen;
+			last_done = cam->armed_time;
+			next_ext_trigger = cam->armed_time;
+		}
+
+		double exposure = exposureUs(cam);
+		double readout = readoutUs(cam);
+		Clock::time_point done;
+		if (cam->mode == TUCCM_SEQUENCE)
+		{
+			//overlapped rolling shutter, the next exposure runs during the readout
+			done = last_done + std::chrono::microseconds((long long) std::max(exposure, readout));
+		}
+		else if (cam->busy)
+		{
+			//first frame of a burst from the trigger, the next ones overlapped
+			if (cam->burst_left == cam->burst_size)
+				done = cam->trigger_time + std::chrono::microseconds((long long) (exposure + readout));
+			else
+				done = last_done + std::chrono::microseconds((long long) std::max(exposure, readout));
+		}
+		else
+		{
+			//wait for a trigger, simulated trigger input in external modes
+			if (cam->mode != TUCCM_TRIGGER_SOFTWARE && g_config.ext_trigger_hz > 0)
+			{
+				cam->cond.wait_until(lock, next_ext_trigger);
+				Clock::time_point now = Clock::now();
+				if (cam->capturing && gen == cam->capture_gen && now >= next_ext_trigger)
+				{
+					next_ext_trigger += std::chrono::microseconds((long long) (1e6 / g_config.ext_trigger_hz));
+					acceptTrigger(cam, now);
+				}
+			}
+			else
+			{
+				cam->cond.wait(lock);
+			}
+			continue;
+		}
+
+		//Cap_Stop interrupts the exposure
+		while (!cam->quit && cam->capturing && gen == cam->capture_gen &&
+		       cam->cond.wait_until(lock, done) != std::cv_status::timeout)
+			;
+		if (cam->quit || !cam->capturing || gen != cam->capture_gen)
+			continue;
+		last_done = done;
+		if (cam->mode != TUCCM_SEQUENCE && --cam->burst_left <= 0)
+			cam->busy = false;
+
+		long long index = cam->next_index++;
+		if (cam->slots.empty() ||
+		    (g_config.drop_every > 0 && (index + 1) % g_config.drop_every == 0))
+			continue;
+
+		//the pixels go to the attached user buffer if there is one, to the oldest slot otherwise
+		Slot& slot = cam->slots[index % cam->slots.size()];
+		slot.index = -1;
+		unsigned char* data;
+		if (cam->attached)
+		{
+			data = cam->attached;
+			slot.in_ring = false;
+			cam->attached = NULL;
+		}
+		else
+		{
+			data = &slot.buffer[0] + cam->geometry.usOffset;
+			slot.in_ring = true;
+			fillHeader(cam, &slot.buffer[0], index, done);
+		}
+		unsigned int capture_gen = cam->capture_gen;
+		cam->filling = true;
+		lock.unlock();
+		fillPixels(cam, data, index);
+		lock.lock();
+		cam->filling = false;
+		cam->cond.notify_all();
+		if (capture_gen != cam->capture_gen)
+			continue;
+		slot.data = data;
+		slot.index = index;
+		cam->newest = index;
+		cam->cond.notify_all();
+	}
+}
+
+//-----------------------------------------------------
+// @brief wait until the generator does not use the ring or the attached buffer any more
+//-----------------------------------------------------
+void waitFilled(_tagTUCAM* cam, std::unique_lock<std::mutex>& lock)
+{
+	while (cam->filling)
+		cam->cond.wait(lock);
+}
+
+//-----------------------------------------------------
+// @brief copy the description of the frame in slot to the caller frame
+//-----------------------------------------------------
+void returnFrame(_tagTUCAM* cam, const Slot& slot, PTUCAM_FRAME pFrame)
+{
+	UINT32 rsd_size = pFrame->uiRsdSize;
+	UCHAR format_get = pFrame->ucFormatGet;
+	*pFrame = cam->geometry;
+	pFrame->uiRsdSize = rsd_size;
+	pFrame->ucFormatGet = format_get;
+	pFrame->uiIndex = (UINT32) slot.index;
+	if (slot.in_ring)
+	{
+		pFrame->pBuffer = (PUCHAR) &slot.buffer[0];
+	}
+	else
+	{
+		pFrame->pBuffer = slot.data;
+		pFrame->usHeader = 0;
+		pFrame->usOffset = 0;
+	}
+}
+
+//-----------------------------------------------------
+// @brief wait until frame index is published (the oldest one still in the ring if index was overwritten)
+//-----------------------------------------------------
+TUCAMRET waitIndex(_tagTUCAM* cam, long long index, PTUCAM_FRAME pFrame)
+{
+	std::unique_lock<std::mutex> lock(cam->mutex);
+	if (cam->slots.empty())
+		return TUCAMRET_NOT_INIT;
+	unsigned int abort_gen = cam->abort_gen;
+	while (cam->newest < index)
+	{
+		if (abort_gen != cam->abort_gen || !cam->capturing)
+			return TUCAMRET_ABORT;
+		cam->cond.wait(lock);
+	}
+	long long nb_slots = cam->slots.size();
+	for (index = std::max(index, cam->newest - nb_slots + 1); index <= cam->newest; index++)
+	{
+		//frames lost on the bus leave holes in the ring
+		const Slot& slot = cam->slots[index % nb_slots];
+		if (slot.index == index)
+		{
+			returnFrame(cam, slot, pFrame);
+			cam->read_next = index + 1;
+			return TUCAMRET_SUCCESS;
+		}
+	}
+	return TUCAMRET_FAILURE;
+}
+
+} // namespace
+
+namespace
+{
+
+//settings saved by TUCAM_File_SaveProfiles, the temperature target is not part of it
+struct MockProfile
+{
+	std::map<int, Capability> capas;
+	std::map<int, Property> props;
+	TUCAM_ROI_ATTR roi;
+	TUCAM_TRIGGER_ATTR trigger;
+	TUCAM_TRGOUT_ATTR trgout[3];
+};
+
+std::map<std::string, MockProfile> g_profiles;
+std::mutex g_profiles_mutex;
+
+} // namespace
+
+//-----------------------------------------------------
+// API
+//-----------------------------------------------------
+TUCAMRET TUCAM_Api_Init(PTUCAM_INIT pInitParam)
+{
+	if (!pInitParam)
+		return TUCAMRET_INVALID_PARAM;
+	g_config.nb_cameras = (int) envDouble("TUCAM_MOCK_NB_CAMERAS", 1);
+	g_config.width = (int) envDouble("TUCAM_MOCK_WIDTH", 2048);
+	g_config.height = (int) envDouble("TUCAM_MOCK_HEIGHT", 2048);
+	g_config.line_time_us = envDouble("TUCAM_MOCK_LINE_TIME_US", 20.);
+	g_config.usb_mbps = envDouble("TUCAM_MOCK_USB_MBPS", 350.);
+	g_config.arm_us = envDouble("TUCAM_MOCK_ARM_US", 0.);
+	g_config.ext_trigger_hz = envDouble("TUCAM_MOCK_EXT_TRIGGER_HZ", 0.);
+	g_config.drop_every = (int) envDouble("TUCAM_MOCK_DROP_EVERY", 0);
+	g_config.packed12 = envDouble("TUCAM_MOCK_PACKED12", 0) != 0;
+	g_config.pattern = envString("TUCAM_MOCK_PATTERN", "ramp");
+	g_config.cooling_s = std::max(1e-3, envDouble("TUCAM_MOCK_COOLING_S", 30.));
+	g_initialized = true;
+	pInitParam->uiCamCount = std::max(0, g_config.nb_cameras);
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Api_Uninit()
+{
+	g_initialized = false;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Dev_Open(PTUCAM_OPEN pOpenParam)
+{
+	if (!g_initialized)
+		return TUCAMRET_NOT_INIT;
+	if (!pOpenParam)
+		return TUCAMRET_INVALID_PARAM;
+	pOpenParam->hIdxTUCam = NULL;
+	if ((int) pOpenParam->uiIdxOpen >= g_config.nb_cameras)
+		return TUCAMRET_NO_CAMERA;
+	_tagTUCAM* cam = new _tagTUCAM;
+	initCamera(cam, pOpenParam->uiIdxOpen);
+	cam->generator = std::thread(generatorThread, cam);
+	pOpenParam->hIdxTUCam = cam;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Dev_Close(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	{
+		std::lock_guard<std::mutex> lock(hTUCam->mutex);
+		hTUCam->quit = true;
+		hTUCam->capturing = false;
+		hTUCam->abort_gen++;
+		hTUCam->cond.notify_all();
+	}
+	hTUCam->generator.join();
+	delete hTUCam;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Dev_GetInfo(HDTUCAM hTUCam, PTUCAM_VALUE_INFO pInfo)
+{
+	if (!hTUCam || !pInfo)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	switch (pInfo->nID)
+	{
+	case TUIDI_BUS:
+		pInfo->nValue = 0x300;	// USB3.0
+		return TUCAMRET_SUCCESS;
+	case TUIDI_CAMERA_MODEL:
+		pInfo->pText = hTUCam->model;
+		return TUCAMRET_SUCCESS;
+	case TUIDI_VERSION_API:
+		pInfo->pText = hTUCam->version_api;
+		return TUCAMRET_SUCCESS;
+	case TUIDI_VERSION_FRMW:
+		pInfo->nValue = 0x1000 + hTUCam->idx;
+		pInfo->pText = hTUCam->version_frmw;
+		return TUCAMRET_SUCCESS;
+	case TUIDI_CURRENT_WIDTH:
+		pInfo->nValue = hTUCam->geometry.usWidth;
+		return TUCAMRET_SUCCESS;
+	case TUIDI_CURRENT_HEIGHT:
+		pInfo->nValue = hTUCam->geometry.usHeight;
+		return TUCAMRET_SUCCESS;
+	case TUIDI_CAMERA_CHANNELS:
+		pInfo->nValue = 1;
+		return TUCAMRET_SUCCESS;
+	default:
+		return TUCAMRET_NOT_SUPPORT;
+	}
+}
+
+TUCAMRET TUCAM_Dev_GetInfoEx(UINT32 uiICam, PTUCAM_VALUE_INFO pInfo)
+{
+	//model names of the cameras not opened yet, the SDK returns pointers to its own strings too
+	static char models[16][64];
+	if (!g_initialized)
+		return TUCAMRET_NOT_INIT;
+	if (!pInfo)
+		return TUCAMRET_INVALID_PARAM;
+	if ((int) uiICam >= g_config.nb_cameras || uiICam >= 16)
+		return TUCAMRET_NO_CAMERA;
+	switch (pInfo->nID)
+	{
+	case TUIDI_BUS:
+		pInfo->nValue = 0x300;	// USB3.0
+		return TUCAMRET_SUCCESS;
+	case TUIDI_CAMERA_MODEL:
+		snprintf(models[uiICam], sizeof(models[uiICam]), "Dhyana 95 (simulated #%u)", uiICam);
+		pInfo->pText = models[uiICam];
+		return TUCAMRET_SUCCESS;
+	default:
+		return TUCAMRET_NOT_SUPPORT;
+	}
+}
+
+//-----------------------------------------------------
+// Registers
+//-----------------------------------------------------
+TUCAMRET TUCAM_Reg_Read(HDTUCAM hTUCam, TUCAM_REG_RW regRW)
+{
+	if (!hTUCam || !regRW.pBuf || regRW.nBufSize <= 0)
+		return TUCAMRET_INVALID_PARAM;
+	if (regRW.nRegType != TUREG_SN)
+		return TUCAMRET_NOT_SUPPORT;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	snprintf(regRW.pBuf, regRW.nBufSize, "%s", hTUCam->serial);
+	return TUCAMRET_SUCCESS;
+}
+
+//-----------------------------------------------------
+// Capabilities
+//-----------------------------------------------------
+TUCAMRET TUCAM_Capa_GetAttr(HDTUCAM hTUCam, PTUCAM_CAPA_ATTR pAttr)
+{
+	if (!hTUCam || !pAttr)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Capability>::const_iterator it = hTUCam->capas.find(pAttr->idCapa);
+	if (it == hTUCam->capas.end())
+		return TUCAMRET_NOT_SUPPORT;
+	pAttr->nValMin = it->second.min;
+	pAttr->nValMax = it->second.max;
+	pAttr->nValDft = it->second.dft;
+	pAttr->nValStep = 1;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Capa_GetValue(HDTUCAM hTUCam, INT32 nCapa, INT32 *pnVal)
+{
+	if (!hTUCam || !pnVal)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Capability>::const_iterator it = hTUCam->capas.find(nCapa);
+	if (it == hTUCam->capas.end())
+		return TUCAMRET_NOT_SUPPORT;
+	*pnVal = it->second.value;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Capa_SetValue(HDTUCAM hTUCam, INT32 nCapa, INT32 nVal)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Capability>::iterator it = hTUCam->capas.find(nCapa);
+	if (it == hTUCam->capas.end())
+		return TUCAMRET_NOT_SUPPORT;
+	if (nVal < it->second.min || nVal > it->second.max)
+		return TUCAMRET_OUT_OF_RANGE;
+	//the geometry of the frame ring can only change when the capture is stopped
+	bool geometry = (nCapa == TUIDC_BITOFDEPTH || nCapa == TUIDC_IMGMODESELECT ||
+			 nCapa == TUIDC_BINNING_SUM || nCapa == TUIDC_BINNING_AVG);
+	if (geometry && hTUCam->capturing && nVal != it->second.value)
+		return TUCAMRET_ACCESSDENY;
+	it->second.value = nVal;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Capa_GetValueText(HDTUCAM hTUCam, PTUCAM_VALUE_TEXT pVal)
+{
+	if (!hTUCam || !pVal || !pVal->pText || pVal->nTextSize <= 0)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Capability>::const_iterator it = hTUCam->capas.find(pVal->nID);
+	if (it == hTUCam->capas.end())
+		return TUCAMRET_NOT_SUPPORT;
+	int value = (int) pVal->dbValue;
+	if (value < it->second.min || value > it->second.max)
+		return TUCAMRET_OUT_OF_RANGE;
+	if (it->second.texts.empty())
+		snprintf(pVal->pText, pVal->nTextSize, "%d", value);
+	else
+		snprintf(pVal->pText, pVal->nTextSize, "%s", it->second.texts[value - it->second.min].c_str());
+	return TUCAMRET_SUCCESS;
+}
+
+//-----------------------------------------------------
+// Properties
+//-----------------------------------------------------
+TUCAMRET TUCAM_Prop_GetAttr(HDTUCAM hTUCam, PTUCAM_PROP_ATTR pAttr)
+{
+	if (!hTUCam || !pAttr)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Property>::const_iterator it = hTUCam->props.find(pAttr->idProp);
+	if (it == hTUCam->props.end())
+		return TUCAMRET_NOT_SUPPORT;
+	pAttr->dbValMin = it->second.min;
+	pAttr->dbValMax = it->second.max;
+	pAttr->dbValDft = it->second.dft;
+	pAttr->dbValStep = it->second.step;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Prop_GetValue(HDTUCAM hTUCam, INT32 nProp, DOUBLE *pdbVal, INT32 nChn)
+{
+	if (!hTUCam || !pdbVal)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Property>::const_iterator it = hTUCam->props.find(nProp);
+	if (it == hTUCam->props.end())
+		return TUCAMRET_NOT_SUPPORT;
+	//the temperature is read from the sensor, it is written as a target
+	*pdbVal = (nProp == TUIDP_TEMPERATURE) ? temperature(hTUCam) : it->second.value;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Prop_SetValue(HDTUCAM hTUCam, INT32 nProp, DOUBLE dbVal, INT32 nChn)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	std::map<int, Property>::iterator it = hTUCam->props.find(nProp);
+	if (it == hTUCam->props.end())
+		return TUCAMRET_NOT_SUPPORT;
+	if (dbVal < it->second.min || dbVal > it->second.max)
+		return TUCAMRET_OUT_OF_RANGE;
+	if (nProp == TUIDP_TEMPERATURE)
+	{
+		hTUCam->temp0 = temperature(hTUCam);
+		hTUCam->temp_t0 = Clock::now();
+	}
+	it->second.value = dbVal;
+	return TUCAMRET_SUCCESS;
+}
+
+//-----------------------------------------------------
+// Buffer
+//-----------------------------------------------------
+TUCAMRET TUCAM_Buf_Alloc(HDTUCAM hTUCam, PTUCAM_FRAME pFrame)
+{
+	if (!hTUCam || !pFrame)
+		return TUCAMRET_INVALID_PARAM;
+	std::unique_lock<std::mutex> lock(hTUCam->mutex);
+	if (hTUCam->capturing)
+		return TUCAMRET_BUSY;
+	waitFilled(hTUCam, lock);
+
+	int bin = binFactor(hTUCam);
+	int depth = imageDepth(hTUCam);
+	const TUCAM_ROI_ATTR& roi = hTUCam->roi;
+	int width = roi.bEnable ? roi.nWidth : g_config.width / bin;
+	int height = roi.bEnable ? roi.nHeight : g_config.height / bin;
+	bool packed = (depth == 12 && g_config.packed12);
+
+	TUCAM_FRAME& g = hTUCam->geometry;
+	memset(&g, 0, sizeof(g));
+	memcpy(g.szSignature, "TU1", 4);
+	g.usHeader = sizeof(TUCAM_IMG_HEADER);
+	g.usOffset = g.usHeader;
+	g.usWidth = width;
+	g.usHeight = height;
+	g.ucDepth = depth;
+	g.ucFormat = TUFRM_FMT_RAW;
+	g.ucChannels = 1;
+	g.ucElemBytes = (depth == 8 || packed) ? 1 : 2;
+	g.uiWidthStep = packed ? (width * 3 + 1) / 2 : width * g.ucElemBytes;
+	g.uiImgSize = g.uiWidthStep * height;
+	g.uiRsdSize = std::max(1u, (unsigned int) pFrame->uiRsdSize);
+	g.ucFormatGet = pFrame->ucFormatGet;
+	hTUCam->bin = bin;
+	hTUCam->depth = depth;
+
+	hTUCam->slots.resize(g.uiRsdSize);
+	for (size_t i = 0; i < hTUCam->slots.size(); i++)
+	{
+		Slot& slot = hTUCam->slots[i];
+		slot.buffer.assign(g.usOffset + g.uiImgSize, 0);
+		slot.index = -1;
+		slot.data = NULL;
+		slot.in_ring = true;
+	}
+	hTUCam->next_index = 0;
+	hTUCam->newest = -1;
+	hTUCam->read_next = 0;
+
+	*pFrame = g;
+	pFrame->pBuffer = &hTUCam->slots[0].buffer[0];
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Buf_Release(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::unique_lock<std::mutex> lock(hTUCam->mutex);
+	if (hTUCam->capturing)
+		return TUCAMRET_BUSY;
+	waitFilled(hTUCam, lock);
+	hTUCam->slots.clear();
+	hTUCam->attached = NULL;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Buf_Attach(HDTUCAM hTUCam, PUCHAR pBuffer, UINT32 uiBufSize)
+{
+	if (!hTUCam || !pBuffer)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	if (hTUCam->slots.empty())
+		return TUCAMRET_NOT_INIT;
+	if (uiBufSize < hTUCam->geometry.uiImgSize)
+		return TUCAMRET_NO_MEMORY;
+	hTUCam->attached = pBuffer;
+	hTUCam->attached_size = uiBufSize;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Buf_Detach(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::unique_lock<std::mutex> lock(hTUCam->mutex);
+	hTUCam->attached = NULL;
+	//the user buffer may still be written by the last frame
+	waitFilled(hTUCam, lock);
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Buf_AbortWait(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	hTUCam->abort_gen++;
+	hTUCam->cond.notify_all();
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Buf_WaitForFrame(HDTUCAM hTUCam, PTUCAM_FRAME pFrame)
+{
+	if (!hTUCam || !pFrame)
+		return TUCAMRET_INVALID_PARAM;
+	long long index;
+	{
+		std::lock_guard<std::mutex> lock(hTUCam->mutex);
+		index = hTUCam->read_next;
+	}
+	return waitIndex(hTUCam, index, pFrame);
+}
+
+TUCAMRET TUCAM_Vendor_ResetIndexFrame(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	for (size_t i = 0; i < hTUCam->slots.size(); i++)
+		hTUCam->slots[i].index = -1;
+	hTUCam->next_index = 0;
+	hTUCam->newest = -1;
+	hTUCam->read_next = 0;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Vendor_WaitForIndexFrame(HDTUCAM hTUCam, PTUCAM_FRAME pFrame)
+{
+	if (!hTUCam || !pFrame)
+		return TUCAMRET_INVALID_PARAM;
+	return waitIndex(hTUCam, pFrame->uiIndex, pFrame);
+}
+
+//-----------------------------------------------------
+// Capture
+//-----------------------------------------------------
+TUCAMRET TUCAM_Cap_SetROI(HDTUCAM hTUCam, TUCAM_ROI_ATTR roiAttr)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	if (hTUCam->capturing)
+		return TUCAMRET_ACCESSDENY;
+	int bin = binFactor(hTUCam);
+	int max_width = g_config.width / bin;
+	int max_height = g_config.height / bin;
+	//the camera aligns the roi like the real one : x on 4 pixels, width on 8 pixels
+	roiAttr.nHOffset &= ~3;
+	roiAttr.nWidth &= ~7;
+	if (roiAttr.nHOffset < 0 || roiAttr.nVOffset < 0 || roiAttr.nWidth <= 0 || roiAttr.nHeight <= 0 ||
+	    roiAttr.nHOffset + roiAttr.nWidth > max_width || roiAttr.nVOffset + roiAttr.nHeight > max_height)
+	{
+		if (roiAttr.bEnable)
+			return TUCAMRET_OUT_OF_RANGE;
+	}
+	hTUCam->roi = roiAttr;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_GetROI(HDTUCAM hTUCam, PTUCAM_ROI_ATTR pRoiAttr)
+{
+	if (!hTUCam || !pRoiAttr)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	*pRoiAttr = hTUCam->roi;
+	if (!pRoiAttr->bEnable)
+	{
+		int bin = binFactor(hTUCam);
+		pRoiAttr->nHOffset = pRoiAttr->nVOffset = 0;
+		pRoiAttr->nWidth = g_config.width / bin;
+		pRoiAttr->nHeight = g_config.height / bin;
+	}
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_SetTrigger(HDTUCAM hTUCam, TUCAM_TRIGGER_ATTR tgrAttr)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	if (hTUCam->capturing)
+		return TUCAMRET_ACCESSDENY;
+	hTUCam->trigger = tgrAttr;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_GetTrigger(HDTUCAM hTUCam, PTUCAM_TRIGGER_ATTR pTgrAttr)
+{
+	if (!hTUCam || !pTgrAttr)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	*pTgrAttr = hTUCam->trigger;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_SetTriggerOut(HDTUCAM hTUCam, TUCAM_TRGOUT_ATTR tgroutAttr)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	if (tgroutAttr.nTgrOutPort < 0 || tgroutAttr.nTgrOutPort > 2)
+		return TUCAMRET_OUT_OF_RANGE;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	hTUCam->trgout[tgroutAttr.nTgrOutPort] = tgroutAttr;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_GetTriggerOut(HDTUCAM hTUCam, PTUCAM_TRGOUT_ATTR pTgrOutAttr)
+{
+	if (!hTUCam || !pTgrOutAttr)
+		return TUCAMRET_INVALID_PARAM;
+	if (pTgrOutAttr->nTgrOutPort < 0 || pTgrOutAttr->nTgrOutPort > 2)
+		return TUCAMRET_OUT_OF_RANGE;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	*pTgrOutAttr = hTUCam->trgout[pTgrOutAttr->nTgrOutPort];
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_DoSoftwareTrigger(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	if (!hTUCam->capturing)
+		return TUCAMRET_NOT_READY;
+	//like the hardware, a trigger sent while the sensor is busy is lost without error
+	acceptTrigger(hTUCam, Clock::now());
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_Start(HDTUCAM hTUCam, UINT32 uiMode)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	if (hTUCam->capturing)
+		return TUCAMRET_BUSY;
+	hTUCam->mode = uiMode;
+	hTUCam->start_time = Clock::now();
+	hTUCam->armed_time = hTUCam->start_time + std::chrono::microseconds((long long) g_config.arm_us);
+	hTUCam->busy = false;
+	hTUCam->burst_left = 0;
+	hTUCam->capturing = true;
+	hTUCam->capture_gen++;
+	hTUCam->cond.notify_all();
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_Cap_Stop(HDTUCAM hTUCam)
+{
+	if (!hTUCam)
+		return TUCAMRET_INVALID_PARAM;
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	hTUCam->capturing = false;
+	hTUCam->capture_gen++;
+	hTUCam->busy = false;
+	hTUCam->abort_gen++;
+	hTUCam->cond.notify_all();
+	return TUCAMRET_SUCCESS;
+}
+
+//-----------------------------------------------------
+// Profiles
+//-----------------------------------------------------
+TUCAMRET TUCAM_File_SaveProfiles(HDTUCAM hTUCam, PCHAR pPrfName)
+{
+	if (!hTUCam || !pPrfName)
+		return TUCAMRET_INVALID_PARAM;
+	MockProfile profile;
+	{
+		std::lock_guard<std::mutex> lock(hTUCam->mutex);
+		profile.capas = hTUCam->capas;
+		profile.props = hTUCam->props;
+		profile.props.erase(TUIDP_TEMPERATURE);
+		profile.roi = hTUCam->roi;
+		profile.trigger = hTUCam->trigger;
+		std::copy(hTUCam->trgout, hTUCam->trgout + 3, profile.trgout);
+	}
+	std::lock_guard<std::mutex> lock(g_profiles_mutex);
+	g_profiles[pPrfName] = profile;
+	return TUCAMRET_SUCCESS;
+}
+
+TUCAMRET TUCAM_File_LoadProfiles(HDTUCAM hTUCam, PCHAR pPrfName)
+{
+	if (!hTUCam || !pPrfName)
+		return TUCAMRET_INVALID_PARAM;
+	MockProfile profile;
+	{
+		std::lock_guard<std::mutex> lock(g_profiles_mutex);
+		std::map<std::string, MockProfile>::const_iterator it = g_profiles.find(pPrfName);
+		if (it == g_profiles.end())
+			return TUCAMRET_FAILOPEN_FILE;
+		profile = it->second;
+	}
+	std::lock_guard<std::mutex> lock(hTUCam->mutex);
+	//like the SDK, only when the capture is stopped
+	if (hTUCam->capturing)
+		return TUCAMRET_ACCESSDENY;
+	hTUCam->capas = profile.capas;
+	for (std::map<int, Property>::const_iterator it = profile.props.begin(); it != profile.props.end(); ++it)
+		hTUCam->props[it->first] = it->second;
+	hTUCam->roi = profile.roi;
+	hTUCam->trigger = profile.trigger;
+	std::copy(profile.trgout, profile.trgout + 3, hTUCam->trgout);
+	return TUCAMRET_SUCCESS;
+}
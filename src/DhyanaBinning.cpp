@@ -0,0 +1,222 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <vector>
+#include <algorithm>
+#include "DhyanaBinning.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DHYANA_BIN_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DHYANA_BIN_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+namespace
+{
+
+//acc[i] += src[i], the bin_y lines of a block are summed in acc
+typedef void (*AccumulateFunc)(unsigned int* acc, const unsigned short* src, int n);
+//dst[i] = (acc[2i] + acc[2i+1]) >> shift, saturated to 16 bits
+typedef void (*Reduce2Func)(const unsigned int* acc, unsigned short* dst, int out_w, unsigned int shift);
+
+struct BinKernels
+{
+	AccumulateFunc	accumulate;
+	Reduce2Func	reduce2;
+	const char*	name;
+};
+
+//-----------------------------------------------------
+// scalar
+//-----------------------------------------------------
+void accumulateScalar(unsigned int* acc, const unsigned short* src, int n)
+{
+	for (int i = 0; i < n; i++)
+		acc[i] += src[i];
+}
+
+void reduce2Scalar(const unsigned int* acc, unsigned short* dst, int out_w, unsigned int shift)
+{
+	for (int i = 0; i < out_w; i++)
+		dst[i] = (unsigned short) std::min((acc[2 * i] + acc[2 * i + 1]) >> shift, 65535u);
+}
+
+#ifdef DHYANA_BIN_AVX2
+//-----------------------------------------------------
+// AVX2, selected at run time
+//-----------------------------------------------------
+__attribute__((target("avx2")))
+void accumulateAvx2(unsigned int* acc, const unsigned short* src, int n)
+{
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+		__m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(s));
+		__m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(s, 1));
+		__m256i a0 = _mm256_loadu_si256((const __m256i*) (acc + i));
+		__m256i a1 = _mm256_loadu_si256((const __m256i*) (acc + i + 8));
+		_mm256_storeu_si256((__m256i*) (acc + i), _mm256_add_epi32(a0, lo));
+		_mm256_storeu_si256((__m256i*) (acc + i + 8), _mm256_add_epi32(a1, hi));
+	}
+	accumulateScalar(acc + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void reduce2Avx2(const unsigned int* acc, unsigned short* dst, int out_w, unsigned int shift)
+{
+	__m128i count = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 16 <= out_w; i += 16)
+	{
+		const __m256i* p = (const __m256i*) (acc + 2 * i);
+		//hadd works inside 128 bits lanes, permute to get the pairs back in order
+		__m256i s0 = _mm256_hadd_epi32(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1));
+		__m256i s1 = _mm256_hadd_epi32(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3));
+		s0 = _mm256_srl_epi32(_mm256_permute4x64_epi64(s0, _MM_SHUFFLE(3, 1, 2, 0)), count);
+		s1 = _mm256_srl_epi32(_mm256_permute4x64_epi64(s1, _MM_SHUFFLE(3, 1, 2, 0)), count);
+		//sums of 2 x bin_y pixels of 16 bits fit in a signed int, packus saturates to 65535
+		__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi32(s0, s1), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*) (dst + i), r);
+	}
+	reduce2Scalar(acc + 2 * i, dst + i, out_w - i, shift);
+}
+#endif
+
+#ifdef DHYANA_BIN_NEON
+//-----------------------------------------------------
+// NEON, always there on aarch64
+//-----------------------------------------------------
+void accumulateNeon(unsigned int* acc, const unsigned short* src, int n)
+{
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		uint16x8_t s = vld1q_u16(src + i);
+		vst1q_u32(acc + i, vaddw_u16(vld1q_u32(acc + i), vget_low_u16(s)));
+		vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(s)));
+	}
+	accumulateScalar(acc + i, src + i, n - i);
+}
+
+void reduce2Neon(const unsigned int* acc, unsigned short* dst, int out_w, unsigned int shift)
+{
+	int32x4_t count = vdupq_n_s32(-(int) shift);
+	int i = 0;
+	for (; i + 4 <= out_w; i += 4)
+	{
+		uint32x4x2_t p = vld2q_u32(acc + 2 * i);
+		uint32x4_t s = vshlq_u32(vaddq_u32(p.val[0], p.val[1]), count);
+		vst1_u16(dst + i, vqmovn_u32(s));
+	}
+	reduce2Scalar(acc + 2 * i, dst + i, out_w - i, shift);
+}
+#endif
+
+BinKernels selectKernels()
+{
+#ifdef DHYANA_BIN_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		BinKernels k = {accumulateAvx2, reduce2Avx2, "avx2"};
+		return k;
+	}
+#endif
+#ifdef DHYANA_BIN_NEON
+	BinKernels k = {accumulateNeon, reduce2Neon, "neon"};
+	return k;
+#else
+	BinKernels k = {accumulateScalar, reduce2Scalar, "scalar"};
+	return k;
+#endif
+}
+
+const BinKernels& kernels()
+{
+	static const BinKernels k = selectKernels();
+	return k;
+}
+
+} // namespace
+
+//-----------------------------------------------------
+// @brief sum or average bin_x x bin_y blocks of src into dst
+//-----------------------------------------------------
+void lima::Dhyana::binFrame16(const unsigned short* src, int src_stride,
+			      unsigned short* dst, int out_w, int out_h,
+			      int bin_x, int bin_y, bool average)
+{
+	const BinKernels& k = kernels();
+	int nb_pixels = out_w * bin_x;
+	unsigned int block = bin_x * bin_y;
+
+	//average by shift if the block size is a power of 2
+	int shift = -1;
+	if (!average)
+		shift = 0;
+	else if ((block & (block - 1)) == 0)
+		for (shift = 0; (1u << shift) < block; shift++)
+			;
+
+	//one line of sums per thread, kept between frames
+	static thread_local std::vector<unsigned int> acc;
+	acc.resize(nb_pixels);
+
+	for (int y = 0; y < out_h; y++)
+	{
+		std::fill(acc.begin(), acc.end(), 0u);
+		const unsigned short* line = src + (size_t) y * bin_y * src_stride;
+		for (int j = 0; j < bin_y; j++)
+			k.accumulate(&acc[0], line + (size_t) j * src_stride, nb_pixels);
+
+		unsigned short* out = dst + (size_t) y * out_w;
+		if (bin_x == 2 && shift >= 0)
+		{
+			k.reduce2(&acc[0], out, out_w, shift);
+			continue;
+		}
+		for (int x = 0; x < out_w; x++)
+		{
+			unsigned int sum = 0;
+			for (int i = 0; i < bin_x; i++)
+				sum += acc[x * bin_x + i];
+			if (average)
+				sum /= block;
+			out[x] = (unsigned short) std::min(sum, 65535u);
+		}
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+const char* lima::Dhyana::binFrameKernel()
+{
+	return kernels().name;
+}
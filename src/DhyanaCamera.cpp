@@ -22,50 +22,183 @@
 
 #include <sstream>
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <cstring>
 #include <math.h>
 #include <climits>
 #include <iomanip>
 #include <signal.h>
+#include <sched.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
+#include <map>
+#include <set>
 #include "lima/Exceptions.h"
 #include "lima/Debug.h"
 #include "lima/MiscUtils.h"
 #include "DhyanaTimer.h"
+#include "DhyanaBinning.h"
+#include "DhyanaUnpack.h"
+#include "DhyanaTrace.h"
 #include "DhyanaCamera.h"
 
 using namespace lima;
 using namespace lima::Dhyana;
 using namespace std;
 
+//Cap_Start is not synchronous with the real camera status, delays tested to find when the camera accepts triggers (ms)
+static const int ARM_PROBE_DELAYS_MS[] = {0, 2, 5, 10, 20, 35, 50, 75, 100};
+//used if the arm latency can not be measured, it was the fixed delay of startAcq
+static const double ARM_LATENCY_DEFAULT_MS = 100.;
+//arm latency measured for each camera model, measured only once per process
+static std::map<std::string, double> s_arm_latency_table;
+static Mutex s_arm_latency_mutex;
+//TUCAM_Api_Init/TUCAM_Api_Uninit are process wide, the SDK session is shared by the Camera objects
+static Mutex s_sdk_mutex;
+static int s_sdk_nb_users = 0;
+static unsigned int s_sdk_nb_cameras = 0;
+//SDK indexes of the cameras opened in this process
+static std::set<int> s_sdk_opened;
+//camera_id prefix selecting a camera by serial number, a camera_id of digits only is an SDK index
+static const std::string SERIAL_PREFIX = "sn:";
+//camera initialized by the calling thread, its init phases use the public methods without waiting for the end of the init
+static thread_local const Camera* t_init_camera = NULL;
+//telemetry sampling period (s) by default
+static const double TELEMETRY_PERIOD_DEFAULT = 1.;
+//min telemetry sampling period (s) during an acquisition, USB control transfers slow down the frames
+static const double TELEMETRY_ACQ_PERIOD = 30.;
+//temperature read at most once per period (s) by default
+static const double TEMPERATURE_REFRESH_DEFAULT = 1.;
+//max binning done in software
+static const int SW_BIN_MAX = 16;
+//SDK ring slots never holding a queued frame : the one written by the camera and the next one,
+//the camera can finish a frame before the grab thread waits for queue room
+static const int SDK_RING_GUARD = 2;
+//ROI constraints, not reported by the SDK : x is rounded down to a multiple of 4, width to a multiple of 8.
+//The same steps are used for every model, no per-model values have been measured yet
+static const RoiAlignment ROI_ALIGNMENT = {4, 1, 8, 1};
+
 //---------------------------
 // @brief  Ctor
 //---------------------------
-Camera::Camera(unsigned short timer_period_ms):
-m_depth(16),
+Camera::Camera(unsigned short timer_period_ms, const std::string& camera_id, bool async_init):
+m_init_thread(NULL),
+m_init_done(false),
+m_init_timings(NbInitPhases, 0.),
+m_init_total(0.),
 m_trigger_mode(IntTrig),
-m_status(Ready),
+m_exp_time(0.),
+m_lat_time(0.),
 m_acq_frame_nb(0),
+m_depth(16),
+m_img_mode_12(-1),
+m_img_mode_16(0),
+m_packed12(false),
+m_status(Initializing),
+m_hw_bin(1, 1),
+m_sw_bin(1, 1),
+m_bin_mode(BinSum),
+m_sw_bin_offset(0),
+m_sw_bin_stride(0),
 m_temperature_target(0),
-m_timer_period_ms(timer_period_ms),
 m_prepared(false),
+m_cold_start(true),
 m_tucam_trigger_mode(TriggerStandard),
 m_tucam_trigger_edge_mode(EdgeRising),
-m_cold_start(true)
+m_timer_period_ms(timer_period_ms),
+m_camera_id(camera_id),
+m_camera_index(-1),
+m_zero_copy(false),
+m_zero_copy_active(false),
+m_attached_ptr(NULL),
+m_nb_sdk_buffers(4),
+m_next_sdk_index(0),
+m_delivery_active(false),
+m_delivery_quit(false),
+m_delivery_waiting(false),
+m_grab_done(false),
+m_delivery_stopped(false),
+m_grab_waiting(false),
+m_grab_frame_nb(0),
+m_roi(0, 0, PIXEL_NB_WIDTH, PIXEL_NB_HEIGHT),
+m_profile_switch_ms(0.),
+m_profile_nb_writes(0),
+m_roi_attr_valid(false),
+m_alloc_depth(0),
+m_alloc_nb_buffers(0),
+m_buffer_cache_hits(0),
+m_buffer_cache_misses(0),
+m_arm_latency(ARM_LATENCY_DEFAULT_MS),
+m_keep_armed(false),
+m_capturing(false),
+m_period_target(0.),
+m_period_nb(0),
+m_period_sum(0.),
+m_period_max_error(0.),
+m_period_seq(0),
+m_frame_stats(false),
+m_exp_sequence_active(false),
+m_frame_exp_last(-1),
+m_prop_cache(NbCachedProperties),
+m_telemetry_period(TELEMETRY_PERIOD_DEFAULT),
+m_telemetry_quit(false),
+m_telemetry_history(TELEMETRY_HISTORY_SIZE),
+m_telemetry_nb(0),
+m_drop_policy(DropRenumber),
+m_sdk_index_valid(false),
+m_nb_received(0),
+m_nb_dropped(0),
+m_nb_duplicated(0),
+m_nb_overwritten(0),
+m_counters_seq(0),
+m_hw_timestamp(false),
+m_ts_nb(0),
+m_ts_cam0(0.),
+m_ts_host0(0.),
+m_ts_mean_x(0.),
+m_ts_mean_y(0.),
+m_ts_cxx(0.),
+m_ts_cxy(0.),
+m_ts_cyy(0.),
+m_ts_seq(0)
 {
 	DEB_CONSTRUCTOR();	
-	//Init TUCAM	
-	init();		
+	//other properties are cached until written
+	m_prop_cache.setMaxAge(PropTemperature, TEMPERATURE_REFRESH_DEFAULT);
+	std::fill(m_outputs_valid, m_outputs_valid + NB_OUTPUT_PORTS, false);
+	clearFrameExposures();
+	m_opCam.hIdxTUCam = NULL;
+	//Init TUCAM now, or in the init thread started at the end
+	if(!async_init)
+	{
+		initialize();
+		endInit("");
+	}
 	//create the acquisition thread
 	DEB_TRACE() << "Create the acquisition thread";
 	m_acq_thread = new AcqThread(*this);
+	//create the delivery thread
+	DEB_TRACE() << "Create the delivery thread";
+	m_delivery_thread = new DeliveryThread(*this);
 	DEB_TRACE() <<"Create the Internal Trigger Timer";
 	m_internal_trigger_timer = new CSoftTriggerTimer(m_timer_period_ms, *this);
+	//create the telemetry thread
+	DEB_TRACE() << "Create the telemetry thread";
+	m_telemetry_thread = new TelemetryThread(*this);
 	m_acq_thread->start();
+	m_delivery_thread->start();
+	m_telemetry_thread->start();
 	m_hThdLock = PTHREAD_MUTEX_INITIALIZER;
 	m_hThdEvent = PTHREAD_COND_INITIALIZER;
 	m_signalled = false;
+	if(async_init)
+	{
+		DEB_TRACE() << "Create the init thread";
+		m_init_thread = new InitThread(*this);
+		m_init_thread->start();
+	}
 }
 
 //-----------------------------------------------------
@@ -74,15 +207,28 @@ m_cold_start(true)
 Camera::~Camera()
 {
 	DEB_DESTRUCTOR();
-	// Close camera
+	//SDK calls can not be interrupted, wait for the end of the init
+	DEB_TRACE() << "Delete the init thread";
+	delete m_init_thread;
+	//the telemetry thread uses the camera, stop it before closing it
+	DEB_TRACE() << "Delete the telemetry thread";
+	delete m_telemetry_thread;
+	//SDK buffer is kept between acquisitions, release it now
+	releaseSdkBuffer();
+	// Close camera, the SDK is uninitialized by the last one
 	DEB_TRACE() << "Close TUCAM API ...";
-	TUCAM_Dev_Close(m_opCam.hIdxTUCam);
-	// Uninitialize SDK API environment
-	DEB_TRACE() << "Uninitialize TUCAM API ...";
-	TUCAM_Api_Uninit();
+	if(m_camera_index >= 0)
+	{
+		AutoMutex lock(s_sdk_mutex);
+		TUCAM_Dev_Close(m_opCam.hIdxTUCam);
+		releaseSdk();
+	}
 	//delete the acquisition thread
 	DEB_TRACE() << "Delete the acquisition thread";
 	delete m_acq_thread;
+	//delete the delivery thread
+	DEB_TRACE() << "Delete the delivery thread";
+	delete m_delivery_thread;
 	//delete the Internal Trigger Timer
 	DEB_TRACE() << "Delete the Internal Trigger Timer";
 	delete m_internal_trigger_timer;
@@ -95,35 +241,149 @@ void Camera::init()
 {
 	DEB_MEMBER_FUNCT();
 
-	DEB_TRACE() << "Initialize TUCAM API ...";
-	m_itApi.pstrConfigPath = NULL;//Camera parameters input saving path is not defined
-	m_itApi.uiCamCount = 0;
+	AutoMutex lock(s_sdk_mutex);
 
-	if(TUCAMRET_SUCCESS != TUCAM_Api_Init(&m_itApi))
+	m_itApi.pstrConfigPath = NULL;//Camera parameters input saving path is not defined
+	m_itApi.uiCamCount = s_sdk_nb_cameras;
+	if(0 == s_sdk_nb_users)
 	{
-		// Initializing SDK API environment failed
-		THROW_HW_ERROR(Error) << "Unable to initialize TUCAM_Api !";
+		DEB_TRACE() << "Initialize TUCAM API ...";
+		m_itApi.uiCamCount = 0;
+		if(TUCAMRET_SUCCESS != TUCAM_Api_Init(&m_itApi))
+		{
+			// Initializing SDK API environment failed
+			THROW_HW_ERROR(Error) << "Unable to initialize TUCAM_Api !";
+		}
+		s_sdk_nb_cameras = m_itApi.uiCamCount;
 	}
+	s_sdk_nb_users++;
 
-	if(0 == m_itApi.uiCamCount)
+	try
 	{
-		// No camera
-		THROW_HW_ERROR(Error) << "Unable to locate the camera !";
+		if(0 == m_itApi.uiCamCount)
+		{
+			// No camera
+			THROW_HW_ERROR(Error) << "Unable to locate the camera !";
+		}
+		openCamera();
+	}
+	catch(...)
+	{
+		releaseSdk();
+		throw;
 	}
+	DEB_TRACE() << "Camera #" << m_camera_index << " opened, serial number " << m_serial_number;
+}
+
+//-----------------------------------------------------
+// @brief open the camera selected by m_camera_id, s_sdk_mutex is locked
+//-----------------------------------------------------
+void Camera::openCamera()
+{
+	DEB_MEMBER_FUNCT();
+	int nb_cameras = m_itApi.uiCamCount;
+	bool by_serial = (m_camera_id.compare(0, SERIAL_PREFIX.size(), SERIAL_PREFIX) == 0);
+	std::string serial_id = by_serial ? m_camera_id.substr(SERIAL_PREFIX.size()) : "";
+	bool by_index = !m_camera_id.empty() && !by_serial &&
+		m_camera_id.find_first_not_of("0123456789") == std::string::npos;
+	if(!m_camera_id.empty() && !by_index && (!by_serial || serial_id.empty()))
+		THROW_HW_ERROR(InvalidValue) << "Invalid camera id \"" << m_camera_id << "\", use an index or " << SERIAL_PREFIX << "<serial number> !";
 
-	DEB_TRACE() << "Open TUCAM API ...";
 	m_opCam.hIdxTUCam = NULL;
-	m_opCam.uiIdxOpen = 0;	
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_Open(&m_opCam))
+	if(by_index)
+	{
+		int index = atoi(m_camera_id.c_str());
+		if(index >= nb_cameras)
+			THROW_HW_ERROR(InvalidValue) << "No camera #" << index << ", " << nb_cameras << " camera(s) found !";
+		if(s_sdk_opened.count(index))
+			THROW_HW_ERROR(Error) << "Camera #" << index << " is already opened in this process !";
+		DEB_TRACE() << "Open TUCAM API ...";
+		m_opCam.uiIdxOpen = index;
+		if(TUCAMRET_SUCCESS != TUCAM_Dev_Open(&m_opCam) || NULL == m_opCam.hIdxTUCam)
+		{
+			// Failed to open camera
+			THROW_HW_ERROR(Error) << "Unable to open the camera #" << index << " !";
+		}
+		m_camera_index = index;
+		m_serial_number = readSerialNumber(m_opCam.hIdxTUCam);
+	}
+	else
+	{
+		//the serial number can only be read from an opened camera, try the free ones in turn
+		for(int index = 0; index < nb_cameras && m_camera_index < 0; index++)
+		{
+			if(s_sdk_opened.count(index))
+				continue;
+			TUCAM_VALUE_INFO valInfo;
+			valInfo.nID = TUIDI_CAMERA_MODEL;
+			valInfo.pText = NULL;
+			if(TUCAMRET_SUCCESS == TUCAM_Dev_GetInfoEx(index, &valInfo) && valInfo.pText)
+				DEB_TRACE() << "Camera #" << index << " : " << valInfo.pText;
+			TUCAM_OPEN opCam;
+			opCam.hIdxTUCam = NULL;
+			opCam.uiIdxOpen = index;
+			if(TUCAMRET_SUCCESS != TUCAM_Dev_Open(&opCam) || NULL == opCam.hIdxTUCam)
+			{
+				DEB_WARNING() << "Unable to open the camera #" << index;
+				continue;
+			}
+			std::string serial = readSerialNumber(opCam.hIdxTUCam);
+			if(m_camera_id.empty() || serial == serial_id)
+			{
+				m_opCam = opCam;
+				m_camera_index = index;
+				m_serial_number = serial;
+			}
+			else
+				TUCAM_Dev_Close(opCam.hIdxTUCam);
+		}
+		if(m_camera_index < 0)
+		{
+			if(m_camera_id.empty())
+				THROW_HW_ERROR(Error) << "Unable to open the camera, all cameras are already opened !";
+			THROW_HW_ERROR(InvalidValue) << "No camera with serial number " << serial_id << " !";
+		}
+	}
+	s_sdk_opened.insert(m_camera_index);
+}
+
+//-----------------------------------------------------
+// @brief forget the camera and uninitialize the SDK if it was the last user, s_sdk_mutex is locked
+//-----------------------------------------------------
+void Camera::releaseSdk()
+{
+	DEB_MEMBER_FUNCT();
+	if(m_camera_index >= 0)
+		s_sdk_opened.erase(m_camera_index);
+	m_camera_index = -1;
+	if(--s_sdk_nb_users == 0)
 	{
-		// Failed to open camera
-		THROW_HW_ERROR(Error) << "Unable to Open the camera !";
+		// Uninitialize SDK API environment
+		DEB_TRACE() << "Uninitialize TUCAM API ...";
+		TUCAM_Api_Uninit();
+		s_sdk_nb_cameras = 0;
 	}
+}
 
-	if(NULL == m_opCam.hIdxTUCam)
+//-----------------------------------------------------
+// @brief serial number register of an opened camera, empty if it can not be read
+//-----------------------------------------------------
+std::string Camera::readSerialNumber(HDTUCAM hTUCam)
+{
+	DEB_STATIC_FUNCT();
+	char sn[TUSIZE_SN];
+	memset(sn, 0, sizeof(sn));
+	TUCAM_REG_RW regRW;
+	regRW.nRegType = TUREG_SN;
+	regRW.pBuf = sn;
+	regRW.nBufSize = TUSIZE_SN;
+	if(TUCAMRET_SUCCESS != TUCAM_Reg_Read(hTUCam, regRW))
 	{
-		THROW_HW_ERROR(Error) << "Unable to open the camera !";
+		DEB_WARNING() << "Unable to read the serial number of the camera";
+		return "";
 	}
+	sn[TUSIZE_SN - 1] = 0;
+	return sn;
 }
 
 //-----------------------------------------------------
@@ -144,33 +404,116 @@ void Camera::reset()
 void Camera::prepareAcq()
 {
         DEB_MEMBER_FUNCT();
+        waitInitDone();
+	LatencyTimer latency(m_latency[StagePrepare]);
+	TraceScope trace("prepareAcq");
 	Timestamp t0 = Timestamp::now();
-	if (!m_prepared)
+	//a new acquisition clears the Fault of the previous one (missing frames)
+	setStatus(Camera::Ready, true);
+	//SDK buffer from the previous acquisition is reused if the geometry did not change
+	if (m_prepared && !isSdkBufferValid())
+	  {
+	    DEB_TRACE() << "SDK buffer geometry changed";
+	    releaseSdkBuffer();
+	  }
+	if (m_prepared)
+	  {
+	    m_buffer_cache_hits++;
+	    DEB_TRACE() << "SDK buffer reused";
+	  }
+	else
 	  {
+	    //done at init, unless it failed
 	    if (m_cold_start)
-	      {
-		//At cold start we must trig a fake capture, otherwise the camera will never capture frames
-		m_cold_start = false;
-		DEB_TRACE() << "Cold start";
-		TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE);
-		TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
-	      }
+		coldStart();
 	       m_frame.pBuffer = NULL;
 	       m_frame.ucFormatGet = TUFRM_FMT_RAW;
-	       m_frame.uiRsdSize = 1;// how many frames do you want
+	       m_frame.uiRsdSize = m_nb_sdk_buffers;// how many frames do you want
 	       
 	       // Alloc buffer after set resolution or set ROI attribute
 	       DEB_TRACE() << "TUCAM_Buf_Alloc";
-	       if(TUCAMRET_SUCCESS != TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame))
+	       Trace::begin("TUCAM_Buf_Alloc");
+	       TUCAMRET ret = TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame);
+	       Trace::end("TUCAM_Buf_Alloc");
+	       if(TUCAMRET_SUCCESS != ret)
 		 {
 		   THROW_HW_ERROR(Error) << "Buff_Alloc failed";
 		 }
 	       m_prepared = true;
+	       m_buffer_cache_misses++;
+	       m_alloc_roi = m_roi;
+	       m_alloc_bin = m_bin;
+	       m_alloc_depth = m_depth;
+	       m_alloc_nb_buffers = m_nb_sdk_buffers;
 	       Timestamp t1 = Timestamp::now();
 	       double delta_time = t1 - t0;
 	       DEB_TRACE() << "Buff_Alloc = " << (int) (delta_time * 1000) << " (ms)";		
 	       t0 = t1;
 	  }
+
+	m_bufferCtrlObj.getBuffer().getFrameDim(m_lima_frame_dim);
+
+	//the exposure can only be changed between the software triggers
+	if (!m_exp_sequence.empty() && m_trigger_mode != IntTrig)
+	  {
+	    THROW_HW_ERROR(InvalidValue) << "Exposure sequence is only available in internal trigger mode";
+	  }
+
+	//12 bits frames can be sent packed (2 pixels in 3 bytes), Lima Bpp12 pixels are 16 bits
+	m_packed12 = (m_depth == 12 && m_frame.ucElemBytes == 1 &&
+		      2 * (unsigned long) m_frame.uiImgSize == 3 * (unsigned long) m_frame.usWidth * m_frame.usHeight);
+	DEB_TRACE() << DEB_VAR4(m_depth, (int) m_frame.ucElemBytes, m_frame.uiImgSize, m_packed12);
+	if (m_depth == 8 && m_sw_bin != Bin(1, 1))
+	  {
+	    THROW_HW_ERROR(NotSupported) << "Software binning " << m_sw_bin << " is not available in 8 bits";
+	  }
+	if (m_packed12 && m_sw_bin != Bin(1, 1))
+	  m_unpack_buf.resize((size_t) m_frame.usWidth * m_frame.usHeight);
+
+	//Software binning : blocks of the SDK frame (sensor pixels) are binned into the Lima frame during the copy
+	if (m_sw_bin != Bin(1, 1))
+	  {
+	    TUCAM_ROI_ATTR roiAttr;
+	    if (TUCAMRET_SUCCESS != TUCAM_Cap_GetROI(m_opCam.hIdxTUCam, &roiAttr))
+	      {
+		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
+	      }
+	    //the camera can align the roi lower than asked, skip the extra pixels
+	    int offset_x = std::max(0, m_roi.getTopLeft().x * m_sw_bin.getX() - roiAttr.nHOffset);
+	    int offset_y = std::max(0, m_roi.getTopLeft().y * m_sw_bin.getY() - roiAttr.nVOffset);
+	    Size out = m_lima_frame_dim.getSize();
+	    if (offset_x + out.getWidth() * m_sw_bin.getX() > roiAttr.nWidth ||
+		offset_y + out.getHeight() * m_sw_bin.getY() > roiAttr.nHeight)
+	      {
+		THROW_HW_ERROR(Error) << "SDK frame too small for software binning " << DEB_VAR2(m_sw_bin, out);
+	      }
+	    m_sw_bin_stride = roiAttr.nWidth;
+	    m_sw_bin_offset = offset_y * m_sw_bin_stride + offset_x;
+	    DEB_TRACE() << "Software binning " << DEB_VAR3(m_sw_bin, m_sw_bin_offset, binFrameKernel());
+	  }
+
+	//Zero-copy is only possible if the Lima frame has exactly the size of the SDK frame
+	m_zero_copy_active = false;
+	if (m_zero_copy)
+	  {
+	    if (m_lima_frame_dim.getMemSize() == (int) m_frame.uiImgSize)
+	      m_zero_copy_active = true;
+	    else
+	      DEB_WARNING() << "Zero-copy disabled, Lima frame size (" << m_lima_frame_dim.getMemSize()
+			    << ") differs from SDK frame size (" << m_frame.uiImgSize << ")";
+	  }
+	DEB_TRACE() << DEB_VAR1(m_zero_copy_active);
+
+	//a frame must be delivered before the SDK (or the SDK attached Lima buffer) is reused
+	int queue_size = std::max(1, m_nb_sdk_buffers - SDK_RING_GUARD);
+	if (m_zero_copy_active)
+	  {
+	    int nb_buffers;
+	    m_bufferCtrlObj.getBuffer().getNbBuffers(nb_buffers);
+	    queue_size = std::max(1, nb_buffers - 1);
+	  }
+	m_frame_queue.resize(queue_size);
+
 	TUCAM_TRIGGER_ATTR tgrAttr;
 	if (TUCAMRET_SUCCESS != TUCAM_Cap_GetTrigger(m_opCam.hIdxTUCam, &tgrAttr))
 	  {
@@ -202,10 +545,28 @@ void Camera::prepareAcq()
 	    tgrAttr.nExpMode = TUCTE_EXPTM;
 	    break;
 	  }
+
+	//Keep armed : the camera is still capturing since the previous sequence, restart it only if the trigger changed
+	if (m_capturing)
+	  {
+	    bool same_trigger = (tgrAttr.nTgrMode == m_capture_trigger.nTgrMode &&
+				 tgrAttr.nExpMode == m_capture_trigger.nExpMode &&
+				 tgrAttr.nEdgeMode == m_capture_trigger.nEdgeMode &&
+				 tgrAttr.nFrames == m_capture_trigger.nFrames &&
+				 tgrAttr.nDelayTm == m_capture_trigger.nDelayTm);
+	    if (m_keep_armed && !m_zero_copy_active && m_trigger_mode == IntTrig && same_trigger)
+	      {
+		DEB_TRACE() << "Camera kept armed, trigger unchanged";
+		return;
+	      }
+	    stopCapture();
+	  }
+
         if(TUCAMRET_SUCCESS != TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, tgrAttr))
 	  {
 	    THROW_HW_ERROR(Error) << "Cap_SetTrigger failed";
 	  }
+	m_capture_trigger = tgrAttr;
 	
 	DEB_TRACE() << "TUCAM_Cap_SetTrigger : " << m_trigger_mode << ", " << tgrAttr.nTgrMode << ", " <<  tgrAttr.nExpMode;
 }
@@ -216,29 +577,49 @@ void Camera::prepareAcq()
 void Camera::startAcq()
 {
 	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	LatencyTimer latency(m_latency[StageStart]);
+	TraceScope trace("startAcq");
 	Timestamp t0 = Timestamp::now();
         Timestamp t1;
 	DEB_TRACE() << "startAcq ...";
-	
-	//@BEGIN : trigger the acquisition
-	DEB_TRACE() << "TUCAM_Cap_Start";
-	if(m_trigger_mode == IntTrig)	
-	{
-	        // Start capture in software trigger
-	  if(TUCAMRET_SUCCESS !=TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE))
-	    {
-	      THROW_HW_ERROR(Error) << "Cap_SetTrigger failed";
-	    }
-	}
+
+	if (m_capturing)
+	  {
+	    //Keep armed (internal trigger only) : capture mode was not stopped at the end of the previous sequence,
+	    //no trigger was sent since, the SDK ring is read from where the previous sequence stopped
+	    DEB_TRACE() << "Camera already armed";
+	  }
 	else
 	  {
-	    if(TUCAMRET_SUCCESS !=TUCAM_Cap_Start(m_opCam.hIdxTUCam, m_tucam_trigger_mode))
-	      {
-		THROW_HW_ERROR(Error) << "Cap_SetTrigger failed";
-	      }
+		//In zero-copy mode the first Lima buffer must be attached before the capture starts
+		if (m_zero_copy_active)
+		  attachFrameBuffer(0);
+
+		//restart reading the SDK ring from its first frame
+		m_next_sdk_index = 0;
+		if (m_nb_sdk_buffers > 1)
+		  TUCAM_Vendor_ResetIndexFrame(m_opCam.hIdxTUCam);
+	
+		//@BEGIN : trigger the acquisition
+		DEB_TRACE() << "TUCAM_Cap_Start";
+		Trace::begin("TUCAM_Cap_Start");
+		TUCAMRET ret;
+		// Start capture in software trigger
+		if(m_trigger_mode == IntTrig)	
+		  ret = TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE);
+		else
+		  ret = TUCAM_Cap_Start(m_opCam.hIdxTUCam, m_tucam_trigger_mode);
+		Trace::end("TUCAM_Cap_Start");
+		if(TUCAMRET_SUCCESS != ret)
+		  {
+		    THROW_HW_ERROR(Error) << "Cap_SetTrigger failed";
+		  }
+		m_capturing = true;
+		m_sdk_index_valid = false;
+		//  Cap_Start is not synchronous enough with the real camera status, so the camera can miss the trigger
+		m_armed_ts = Timestamp(double(Timestamp::now()) + m_arm_latency / 1000.);
 	  }
-	//  Cap_Start is not synchronous enough with the real camera status, so the camera can miss the trigger
-	usleep(1e5);
 	
 	////DEB_TRACE() << "TUCAM CreateEvent";
 	pthread_cond_init(&m_hThdEvent, NULL);
@@ -246,8 +627,21 @@ void Camera::startAcq()
 	//@BEGIN : trigger the acquisition
 	if(m_trigger_mode == IntTrig)	
 	{
+		//the timer does not trigger before the camera is armed, then once per frame period
 		DEB_TRACE() <<"Start Internal Trigger Timer";
-		m_internal_trigger_timer->start();
+		double first_delay = std::max(0., double(m_armed_ts) - double(Timestamp::now()));
+		m_internal_trigger_timer->setExposureSequence(m_exp_sequence, m_lat_time);
+		m_exp_sequence_active = !m_exp_sequence.empty();
+		if(m_exp_sequence_active)
+			m_prop_cache.invalidate(PropExpTime);
+		m_internal_trigger_timer->start(m_exp_time + m_lat_time, first_delay);
+	}
+	else
+	{
+		//external triggers can come as soon as startAcq returns
+		double remaining = double(m_armed_ts) - double(Timestamp::now());
+		if(remaining > 0)
+			usleep((useconds_t) (remaining * 1e6));
 	}
 	t1 = Timestamp::now();
 	double delta_time = t1 - t0;
@@ -255,9 +649,46 @@ void Camera::startAcq()
 	t0=t1;
 	AutoMutex lock(m_cond.mutex());	
 
+	//counters reset, getFrameCounters retries while the sequence is odd
+	m_counters_seq.fetch_add(1, std::memory_order_acq_rel);
 	m_acq_frame_nb = 0;
+	m_grab_frame_nb = 0;
+	m_nb_received = 0;
+	m_nb_dropped = 0;
+	m_nb_duplicated = 0;
+	m_nb_overwritten = 0;
+	m_counters_seq.fetch_add(1, std::memory_order_acq_rel);
+	m_frame_stats_ring.clear();
+	clearFrameExposures();
 	StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj.getBuffer();
-	buffer_mgr.setStartTimestamp(Timestamp::now());
+	m_start_ts = Timestamp::now();
+	buffer_mgr.setStartTimestamp(m_start_ts);
+	//new camera -> host clock fit for each acquisition
+	unsigned int ts_seq = m_ts_seq.load(std::memory_order_relaxed);
+	m_ts_seq.store(ts_seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_ts_nb = 0;
+	m_ts_seq.store(ts_seq + 2, std::memory_order_release);
+
+	//Start delivery thread, it waits for the frames queued by the acquisition thread
+	{
+		AutoMutex dLock(m_delivery_cond.mutex());
+		m_frame_queue.clear();
+		//internal trigger : the frame period is exposure + latency, other modes and exposure sequences have no fixed period
+		//getFramePeriod retries while the sequence is odd
+		unsigned int seq = m_period_seq.load(std::memory_order_relaxed);
+		m_period_seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_period_target = (m_trigger_mode == IntTrig && m_exp_sequence.empty()) ? m_exp_time + m_lat_time : 0.;
+		m_period_nb = 0;
+		m_period_sum = 0.;
+		m_period_max_error = 0.;
+		m_period_seq.store(seq + 2, std::memory_order_release);
+		m_grab_done = false;
+		m_delivery_stopped = false;
+		m_delivery_active = true;
+		m_delivery_cond.broadcast();
+	}
 	
 	DEB_TRACE() << "Ensure that Acquisition is Started  & wait thread to be started";
 	setStatus(Camera::Exposure, false);		
@@ -280,7 +711,14 @@ void Camera::startAcq()
 void Camera::stopAcq()
 {
 	DEB_MEMBER_FUNCT();
+	//nothing runs before the end of the init, the status stays Initializing or Fault
+	if(!m_init_done.load() || !m_init_error.empty())
+		return;
+	LatencyTimer latency(m_latency[StageStop]);
+	TraceScope trace("stopAcq");
+	Trace::begin("stopAcq lock");
 	AutoMutex aLock(m_cond.mutex());
+	Trace::end("stopAcq lock");
 	DEB_TRACE() << "stopAcq ...";
 	// Don't do anything if acquisition is idle.
 	Timestamp t0 = Timestamp::now();
@@ -289,19 +727,33 @@ void Camera::stopAcq()
 	{
 		m_wait_flag = true;
 		m_cond.broadcast();		
+		//wake up the acquisition thread if waiting for the delivery thread
+		{
+			AutoMutex dLock(m_delivery_cond.mutex());
+			m_delivery_cond.broadcast();
+		}
    
+		//Keep armed : if all the frames were grabbed, the acq. thread is not waiting, the capture can go on.
+		//Only in internal trigger, an external trigger between sequences would leave a frame in the SDK ring
+		bool keep_capture = m_keep_armed && !m_zero_copy_active && m_trigger_mode == IntTrig &&
+			m_nb_frames && m_grab_frame_nb >= m_nb_frames;
+
 		//@BEGIN : Ensure that Acquisition is Stopped before return ...			
-		DEB_TRACE() << "TUCAM_Buf_AbortWait";
-		
-		TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
+		if(!keep_capture)
+		{
+			DEB_TRACE() << "TUCAM_Buf_AbortWait";
+			TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
+		}
 		t1 = Timestamp::now();
 		double delta_time = t1 - t0;
 		DEB_TRACE() << "AbortWait = " << (int) (delta_time * 1000) << " (ms)";		
 		t0 = t1;
+		Trace::begin("wait acq thread");
 		pthread_mutex_lock(&m_hThdLock);
 		while (!m_signalled) {
 		  pthread_cond_wait(&m_hThdEvent, &m_hThdLock);
 		}
+		Trace::end("wait acq thread");
 		m_signalled = false;
 		pthread_mutex_unlock(&m_hThdLock);
 		pthread_cond_destroy(&m_hThdEvent);
@@ -311,20 +763,16 @@ void Camera::stopAcq()
 		t0 = t1;
 
 		// Stop capture   
-		DEB_TRACE() << "TUCAM_Cap_Stop";
-		TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+		if(keep_capture)
+			DEB_TRACE() << "Keep the camera armed for the next sequence";
+		else
+			stopCapture();
 		t1 = Timestamp::now();
 		delta_time = t1 - t0;
 		DEB_TRACE() << "Cap_Stop = " << (int) (delta_time * 1000) << " (ms)";		
 		t0 = t1;
-		//Release alloc buffer after stop capture
-		DEB_TRACE() << "TUCAM_Buf_Release";
-		TUCAM_Buf_Release(m_opCam.hIdxTUCam);
-		m_prepared = false;
-		t1 = Timestamp::now();
-		delta_time = t1 - t0;
-		DEB_TRACE() << "Buf_Release = " << (int) (delta_time * 1000) << " (ms)";		
-		t0 = t1;
+		//Give the SDK its own buffer back, it is kept for the next acquisition
+		detachFrameBuffer();
 	
 		//@BEGIN : trigger the acquisition
 		if(m_trigger_mode == IntTrig)	
@@ -334,6 +782,15 @@ void Camera::stopAcq()
 		  }
 		//@END
 	}	
+	//the last exposure of the sequence is still in the camera, the trigger timer can have stopped by itself
+	if(m_exp_sequence_active)
+	{
+		m_internal_trigger_timer->stop();
+		m_prop_cache.invalidate(PropExpTime);
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, m_exp_time * 1000))
+			DEB_ERROR() << "Unable to Write TUIDP_EXPOSURETM to the camera !";
+		m_exp_sequence_active = false;
+	}
 	//@BEGIN
 	//now detector is ready
 	DEB_TRACE() << "Ensure that Acquisition is Stopped";
@@ -351,10 +808,10 @@ void Camera::stopAcq()
 void Camera::setStatus(Camera::Status status, bool force)
 {
 	DEB_MEMBER_FUNCT();
-	//AutoMutex aLock(m_cond.mutex());
-	if(force || m_status != Camera::Fault)
-		m_status = status;
-	//m_cond.broadcast();
+	//Fault is only cleared by force, it must not be overwritten by another thread between test and set
+	Camera::Status current = m_status.load();
+	while((force || current != Camera::Fault) && !m_status.compare_exchange_weak(current, status))
+		;
 }
 
 //-----------------------------------------------------
@@ -363,821 +820,2902 @@ void Camera::setStatus(Camera::Status status, bool force)
 void Camera::getStatus(Camera::Status& status)
 {
 	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cond.mutex());
-	status = m_status;
+	//no lock, status polling must not wait for the acquisition thread handshakes
+	status = m_status.load();
 
 	DEB_RETURN() << DEB_VAR1(status);
 }
 
 //-----------------------------------------------------
-//
+// @brief false if the SDK reused the ring slot of the frame before the end of the copy, bptr is then blank
 //-----------------------------------------------------
-bool Camera::readFrame(void *bptr, int& frame_nb)
+bool Camera::readFrame(const FrameDesc& frame, void *bptr)
 {
 	DEB_MEMBER_FUNCT();
-	Timestamp t0 = Timestamp::now();
+	LatencyTimer latency(m_latency[StageCopy]);
+	TraceScope trace("copy");
 
 	//@BEGIN : Get frame from Driver/API & copy it into bptr already allocated 
-//	DEB_TRACE() << "Copy Buffer image into Lima Frame Ptr";
-	memcpy((unsigned short *) bptr, (unsigned short *) (m_frame.pBuffer + m_frame.usOffset), m_frame.uiImgSize);//we need a nb of BYTES .		
-	frame_nb = m_frame.uiIndex;
-	//@END	
-
-	Timestamp t1 = Timestamp::now();
-	double delta_time = t1 - t0;
-	DEB_TRACE() << "readFrame : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
-	return false;
-}
-
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::AcqThread::threadFunction()
-{
-	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj.getBuffer();
-
-	while(!m_cam.m_quit)
+	bool stats_done = false;
+	//no copy if the SDK wrote directly into the Lima buffer (zero-copy)
+	if (!frame.data)
 	{
-		while(m_cam.m_wait_flag && !m_cam.m_quit)
+		//blank frame in place of a frame lost by the SDK
+		memset(bptr, 0, m_lima_frame_dim.getMemSize());
+	}
+	else if (m_sw_bin != Bin(1, 1))
+	{
+		const unsigned short* src = (const unsigned short*) frame.data;
+		if (m_packed12)
 		{
-			DEB_TRACE() << "Wait for start acquisition ...";
-			m_cam.m_thread_running = false;
-			m_cam.m_cond.broadcast();
-			m_cam.m_cond.wait();
+			unpack12(frame.data, &m_unpack_buf[0], (int) m_unpack_buf.size());
+			src = &m_unpack_buf[0];
 		}
-
-		//if quit is requested (requested only by destructor)
-		if(m_cam.m_quit)
-			return;
-
-		DEB_TRACE() << "Running ...";
-		m_cam.m_thread_running = true;
-		m_cam.m_cond.broadcast();
-		aLock.unlock();		
-
-		Timestamp t0_capture = Timestamp::now();
-
-		//@BEGIN 
-		DEB_TRACE() << "Capture all frames ...";
-		bool continueFlag = true;
-		while(continueFlag && (!m_cam.m_nb_frames || m_cam.m_acq_frame_nb < m_cam.m_nb_frames))
+		Size out = m_lima_frame_dim.getSize();
+		binFrame16(src + m_sw_bin_offset, m_sw_bin_stride,
+			   (unsigned short*) bptr, out.getWidth(), out.getHeight(),
+			   m_sw_bin.getX(), m_sw_bin.getY(), m_bin_mode == BinAvg);
+	}
+	else if (m_packed12)
+	{
+		unpack12(frame.data, (unsigned short*) bptr, m_lima_frame_dim.getSize().getWidth() * m_lima_frame_dim.getSize().getHeight());
+	}
+	else if (frame.data != (unsigned char*) bptr)
+	{
+	//	DEB_TRACE() << "Copy Buffer image into Lima Frame Ptr";
+		unsigned char* dst = (unsigned char*) bptr;
+		bool overlap = frame.data < dst + frame.size && dst < frame.data + frame.size;
+		if (m_frame_stats && !overlap && (int) frame.size == m_lima_frame_dim.getMemSize())
 		{
-			// Check first if acq. has been stopped
-			if(m_cam.m_wait_flag)
-			{
-				DEB_TRACE() << "AcqThread has been stopped from user";
-				continueFlag = false;
-				continue;
-			}
-
-			//set status to exposure
-			m_cam.setStatus(Camera::Exposure, false);
-			
-			//wait frame from TUCAM API ...
-			if(m_cam.m_acq_frame_nb == 0)//display TRACE only once ...
-			{				
-				DEB_TRACE() << "TUCAM_Buf_WaitForFrame ...";
-			}
-			
-			if(TUCAMRET_SUCCESS == TUCAM_Buf_WaitForFrame(m_cam.m_opCam.hIdxTUCam, &m_cam.m_frame))
-			{
-				// Grabbing was successful, process image
-				m_cam.setStatus(Camera::Readout, false);
-
-				//Prepare Lima Frame Ptr 
-				void* bptr = buffer_mgr.getFrameBufferPtr(m_cam.m_acq_frame_nb);
-
-				//Copy Frame into Lima Frame Ptr
-				int frame_nb = 0;
-				m_cam.readFrame(bptr, frame_nb);
-		
-				//Push the image buffer through Lima 
-				Timestamp t0 = Timestamp::now();
-				////DEB_TRACE() << "Declare a Lima new Frame Ready (" << m_cam.m_acq_frame_nb << ")";
-				HwFrameInfoType frame_info;
-				frame_info.acq_frame_nb = m_cam.m_acq_frame_nb;
-				continueFlag = buffer_mgr.newFrameReady(frame_info);
-				m_cam.m_acq_frame_nb++;
-				Timestamp t1 = Timestamp::now();
-				double delta_time = t1 - t0;
-				
-				//wait latency after each frame , except for the last image 
-				if((!m_cam.m_nb_frames) || (m_cam.m_acq_frame_nb < m_cam.m_nb_frames) && (m_cam.m_lat_time))
-				{
-					////DEB_TRACE() << "Wait latency time : " << m_cam.m_lat_time * 1000 << " (ms) ...";
-					usleep((DWORD) (m_cam.m_lat_time * 1000000));
-				}				
-			}
-			else
-			{
-				DEB_TRACE() << "Unable to get the frame from the camera !";
-			}
+			//statistics computed while the pixels are copied, the frame is read only once
+			computeFrameStats(frame, frame.data, bptr);
+			stats_done = true;
 		}
-
-		//
-		////DEB_TRACE() << "TUCAM SetEvent";
-		pthread_mutex_lock(&m_cam.m_hThdLock);
-		m_cam.m_signalled = true;
-		pthread_cond_signal(&m_cam.m_hThdEvent);
-		pthread_mutex_unlock(&m_cam.m_hThdLock);
-		//@END
-		
-		//stopAcq only if this is not already done		
-		DEB_TRACE() << "stopAcq only if this is not already done";
-		if(!m_cam.m_wait_flag)
+		else
 		{
-			////DEB_TRACE() << "stopAcq";
-			m_cam.stopAcq();
+			//SDK data can overlap the Lima buffer if zero-copy has just been disabled
+			memmove(bptr, frame.data, frame.size);//we need a nb of BYTES .		
 		}
+	}
+	//statistics of the Lima frame (binned, unpacked or written by the SDK), blank frames have none
+	if (m_frame_stats && frame.data && !stats_done)
+		computeFrameStats(frame, bptr, NULL);
+	//@END	
 
-		//now detector is ready
-		m_cam.setStatus(Camera::Ready, false);
-		DEB_TRACE() << "AcqThread is no more running";		
-		
-		Timestamp t1_capture = Timestamp::now();
-		double delta_time_capture = t1_capture - t0_capture;
-		DEB_TRACE() << "Capture all frames elapsed time = " << (int) (delta_time_capture * 1000) << " (ms)";			
-
-		aLock.lock();
-		m_cam.m_thread_running = false;
-		m_cam.m_wait_flag = true;
+	//the camera writes the header of a slot before its pixels
+	if (frame.slot && ((const TUCAM_IMG_HEADER*) frame.slot)->uiIndex != frame.sdk_index)
+	{
+		DEB_WARNING() << "SDK frame " << frame.sdk_index << " overwritten before its copy, frame "
+			      << frame.frame_nb << " is blank";
+		memset(bptr, 0, m_lima_frame_dim.getMemSize());
+		m_nb_overwritten++;
+		return false;
 	}
+	return true;
 }
 
 //-----------------------------------------------------
-//
+// @brief statistics of the Lima frame in src, copied to dst if it is not NULL, stored in the stats ring
 //-----------------------------------------------------
-Camera::AcqThread::AcqThread(Camera& cam):
-m_cam(cam)
+void Camera::computeFrameStats(const FrameDesc& frame, const void* src, void* dst)
 {
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	m_cam.m_wait_flag = true;
-	m_cam.m_quit = false;
-	aLock.unlock();
-	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+	DEB_MEMBER_FUNCT();
+	FrameStats stats;
+	Size size = m_lima_frame_dim.getSize();
+	int nb_pixels = size.getWidth() * size.getHeight();
+	if (m_depth == 8)
+	{
+		copyFrameStats8((const unsigned char*) src, (unsigned char*) dst, nb_pixels, stats);
+	}
+	else
+	{
+		//summed software binning can exceed 12 bits
+		bool sum = (m_sw_bin != Bin(1, 1) && m_bin_mode == BinSum);
+		int depth = (m_depth == 12 && !sum) ? 12 : 16;
+		copyFrameStats16((const unsigned short*) src, (unsigned short*) dst, nb_pixels, depth, stats);
+	}
+	stats.frame_nb = frame.frame_nb;
+	m_frame_stats_ring.push(stats);
 }
 
 //-----------------------------------------------------
-//
+// @brief wait for the next frame, the SDK ring is drained in order using the frame index
 //-----------------------------------------------------
-Camera::AcqThread::~AcqThread()
+bool Camera::waitForFrame(int& index_gap)
 {
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	m_cam.m_wait_flag = true;
-	m_cam.m_quit = true;
-	m_cam.m_cond.broadcast();
-	aLock.unlock();
-	join();
+	DEB_MEMBER_FUNCT();
+	TraceScope trace("sdk wait");
+	TUCAMRET ret;
+	if (m_nb_sdk_buffers > 1 && !m_zero_copy_active)
+	{
+		//ask for the frame following the last one read, even if newer frames are already in the ring
+		m_frame.uiIndex = m_next_sdk_index;
+		ret = TUCAM_Vendor_WaitForIndexFrame(m_opCam.hIdxTUCam, &m_frame);
+	}
+	else
+	{
+		ret = TUCAM_Buf_WaitForFrame(m_opCam.hIdxTUCam, &m_frame);
+	}
+	if (TUCAMRET_SUCCESS != ret)
+		return false;
+
+	//the first frame after TUCAM_Cap_Start is the reference of the index sequence
+	index_gap = m_sdk_index_valid ? (int) (m_frame.uiIndex - m_next_sdk_index) : 0;
+	if (index_gap)
+		DEB_TRACE() << "SDK frame index " << m_frame.uiIndex << " while expecting " << m_next_sdk_index;
+	//an old frame does not move the expected index back
+	if (index_gap >= 0)
+		m_next_sdk_index = m_frame.uiIndex + 1;
+	m_sdk_index_valid = true;
+	return true;
 }
 
 //-----------------------------------------------------
-//
+// @brief frames are missing before the one just received, apply the drop policy
 //-----------------------------------------------------
-void Camera::getImageType(ImageType& type)
+bool Camera::handleDroppedFrames(int nb_missing)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Fix the image type (pixel depth) into Driver/API		
-	switch(m_depth)
+	DEB_PARAM() << DEB_VAR1(nb_missing);
+	m_nb_dropped += nb_missing;
+	DEB_WARNING() << nb_missing << " frame(s) lost by the SDK before frame " << m_grab_frame_nb;
+
+	switch(m_drop_policy)
 	{
-		case 16: type = Bpp16;
-			break;
-		default:
-			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
+	case DropFault:
+		DEB_ERROR() << "Frame(s) lost, acquisition stopped";
+		setStatus(Camera::Fault, true);
+		return false;
+	case DropInsertBlank:
+		//in zero-copy mode the received frame is already in the Lima buffer of the first missing one
+		if(m_zero_copy_active)
+		{
+			DEB_WARNING() << "No blank frame in zero-copy mode, frames renumbered";
 			break;
+		}
+		for(int i = 0; i < nb_missing && (!m_nb_frames || m_grab_frame_nb < m_nb_frames); i++)
+		{
+			if(!waitQueueRoom())
+				return false;
+			FrameDesc frame;
+			frame.data = NULL;
+			frame.slot = NULL;
+			frame.size = m_frame.uiImgSize;
+			frame.sdk_index = m_next_sdk_index - 1 - nb_missing + i;
+			frame.frame_nb = m_grab_frame_nb;
+			frame.timestamp = Timestamp::now();
+			frame.received_us = LatencyHistogram::now();
+			//m_nb_received and m_nb_dropped already count the received frame and the missing ones
+			frame.exp_time = sequenceExposure(m_nb_received + m_nb_dropped - m_nb_duplicated - 1 - nb_missing + i);
+			pushFrame(frame);
+			m_grab_frame_nb++;
+		}
+		break;
+	case DropRenumber:
+		break;
 	}
-	//@END	
-	return;
+	return true;
 }
 
 //-----------------------------------------------------
-//
+// @brief set the arm latency from the per-model table, measure it if the model is not yet known
 //-----------------------------------------------------
-void Camera::setImageType(ImageType type)
+void Camera::calibrateArmLatency()
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setImageType - " << DEB_VAR1(type);
-	//@BEGIN : Fix the image type (pixel depth) into Driver/API	
-	switch(type)
+	std::string model;
+	getDetectorModel(model);
+
+	AutoMutex aLock(s_arm_latency_mutex);
+	std::map<std::string, double>::iterator it = s_arm_latency_table.find(model);
+	if(it != s_arm_latency_table.end())
+	{
+		m_arm_latency = it->second;
+		DEB_TRACE() << "Arm latency of " << model << " already measured : " << m_arm_latency << " (ms)";
+		return;
+	}
+
+	Timestamp t0 = Timestamp::now();
+	//probe with a short exposure, the current one is restored after
+	double exp_ms = 0;
+	TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, &exp_ms);
+	TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, 1.);
+
+	m_frame.pBuffer = NULL;
+	m_frame.ucFormatGet = TUFRM_FMT_RAW;
+	m_frame.uiRsdSize = 1;
+	if(TUCAMRET_SUCCESS != TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame))
+	{
+		DEB_WARNING() << "Unable to measure the arm latency, Buf_Alloc failed";
+		TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_ms);
+		return;
+	}
+
+	//the first capture after power on is never triggered (see cold start), it is done before probing
+	if(m_cold_start)
+		coldStart();
+
+	bool found = false;
+	for(unsigned i = 0; i < sizeof(ARM_PROBE_DELAYS_MS) / sizeof(ARM_PROBE_DELAYS_MS[0]); i++)
+	{
+		if(probeArmLatency(ARM_PROBE_DELAYS_MS[i]))
+		{
+			m_arm_latency = ARM_PROBE_DELAYS_MS[i];
+			found = true;
+			break;
+		}
+	}
+
+	TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+	TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_ms);
+
+	if(found)
+		s_arm_latency_table[model] = m_arm_latency;
+	else
+	{
+		m_arm_latency = ARM_LATENCY_DEFAULT_MS;
+		DEB_WARNING() << "No trigger accepted while measuring the arm latency, use default " << m_arm_latency << " (ms)";
+	}
+	double delta_time = Timestamp::now() - t0;
+	DEB_TRACE() << "Arm latency of " << model << " = " << m_arm_latency << " (ms), measured in " << (int) (delta_time * 1000) << " (ms)";
+}
+
+//-----------------------------------------------------
+// @brief run the init phases and time them, errors are thrown
+//-----------------------------------------------------
+void Camera::initialize()
+{
+	DEB_MEMBER_FUNCT();
+	TraceScope scope("init");
+	t_init_camera = this;
+	Timestamp t0 = Timestamp::now();
+	Timestamp t = t0;
+	try
+	{
+		for(int phase = 0; phase < NbInitPhases; phase++)
+		{
+			switch(phase)
+			{
+			case InitOpen:
+				//Init TUCAM
+				init();
+				//exposure asked by the next setExpTime, the current one of the camera until then
+				getExpTime(m_exp_time);
+				break;
+			case InitColdStart:
+				//At cold start we must trig a fake capture, otherwise the camera will never capture frames
+				coldStart();
+				break;
+			case InitArmLatency:
+				//measure how long the camera needs to accept triggers after TUCAM_Cap_Start
+				calibrateArmLatency();
+				break;
+			case InitHwTimestamp:
+				//frame timestamps from the camera if it can
+				setHwTimestamp(true);
+				break;
+			case InitImageType:
+				//readout modes, 16 bits by default
+				initImageType();
+				break;
+			case InitBinning:
+				//binning factors the camera can do
+				initBinning();
+				break;
+			case InitRoiAlignment:
+				//ROI constraints of the camera
+				initRoiAlignment();
+				break;
+			}
+			Timestamp now = Timestamp::now();
+			double delta_ms = (now - t) * 1000;
+			t = now;
+			DEB_TRACE() << "Init phase " << phase << " done in " << delta_ms << " (ms)";
+			AutoMutex aLock(m_init_cond.mutex());
+			m_init_timings[phase] = delta_ms;
+			m_init_total = (t - t0) * 1000;
+		}
+	}
+	catch(...)
+	{
+		t_init_camera = NULL;
+		throw;
+	}
+	t_init_camera = NULL;
+	DEB_TRACE() << "Camera initialized in " << m_init_total << " (ms)";
+}
+
+//-----------------------------------------------------
+// @brief status is Ready, or Fault if the init failed, and the waiting threads are woken up
+//-----------------------------------------------------
+void Camera::endInit(const std::string& error)
+{
+	DEB_MEMBER_FUNCT();
+	t_init_camera = NULL;
+	if(!error.empty())
+		DEB_ERROR() << "Camera initialization failed : " << error;
+	AutoMutex aLock(m_init_cond.mutex());
+	m_init_error = error;
+	m_status = error.empty() ? Ready : Fault;
+	m_init_done = true;
+	m_init_cond.broadcast();
+	aLock.unlock();
+
+	//the telemetry thread starts sampling
+	AutoMutex tLock(m_telemetry_cond.mutex());
+	m_telemetry_cond.broadcast();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::waitInitDone()
+{
+	DEB_MEMBER_FUNCT();
+	if(!m_init_done.load())
+	{
+		if(t_init_camera == this)
+			return;
+		AutoMutex aLock(m_init_cond.mutex());
+		while(!m_init_done.load())
+			m_init_cond.wait();
+	}
+	if(!m_init_error.empty())
+		THROW_HW_ERROR(Error) << "Camera initialization failed : " << m_init_error;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getInitTimings(std::vector<double>& phases_ms, double& total_ms)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_init_cond.mutex());
+	phases_ms = m_init_timings;
+	total_ms = m_init_total;
+}
+
+//-----------------------------------------------------
+// @brief the first capture after power on is never triggered, start and stop a fake one
+//-----------------------------------------------------
+void Camera::coldStart()
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "Cold start";
+	TraceScope scope("cold start");
+	m_cold_start = false;
+	TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE);
+	TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+}
+
+//-----------------------------------------------------
+// @brief true if a software trigger sent delay_ms after TUCAM_Cap_Start produces a frame
+//-----------------------------------------------------
+bool Camera::probeArmLatency(int delay_ms)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(delay_ms);
+	//TUCAM_Buf_WaitForFrame has no timeout, the watchdog aborts it if the trigger was missed
+	CAbortWaitTimer watchdog(500, *this);
+
+	if(TUCAMRET_SUCCESS != TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE))
+		return false;
+	if(delay_ms > 0)
+		usleep(delay_ms * 1000);
+	TUCAM_Cap_DoSoftwareTrigger(m_opCam.hIdxTUCam);
+	watchdog.start();
+	bool accepted = (TUCAMRET_SUCCESS == TUCAM_Buf_WaitForFrame(m_opCam.hIdxTUCam, &m_frame)) && !watchdog.hasFired();
+	watchdog.stop();
+	TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+	DEB_RETURN() << DEB_VAR1(accepted);
+	return accepted;
+}
+
+//-----------------------------------------------------
+// @brief leave the capture mode, the next startAcq will call TUCAM_Cap_Start again
+//-----------------------------------------------------
+void Camera::stopCapture()
+{
+	DEB_MEMBER_FUNCT();
+	if (!m_capturing)
+		return;
+	DEB_TRACE() << "TUCAM_Cap_Stop";
+	TraceScope trace("TUCAM_Cap_Stop");
+	TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+	m_capturing = false;
+}
+
+//-----------------------------------------------------
+// @brief true if the allocated SDK buffer matches the current geometry
+//-----------------------------------------------------
+bool Camera::isSdkBufferValid()
+{
+	DEB_MEMBER_FUNCT();
+	return m_prepared &&
+		m_alloc_roi == m_roi &&
+		m_alloc_bin == m_bin &&
+		m_alloc_depth == m_depth &&
+		m_alloc_nb_buffers == m_nb_sdk_buffers;
+}
+
+//-----------------------------------------------------
+// @brief release the SDK buffer, it will be allocated again at next prepareAcq
+//-----------------------------------------------------
+void Camera::releaseSdkBuffer()
+{
+	DEB_MEMBER_FUNCT();
+	if (!m_prepared)
+		return;
+	Timestamp t0 = Timestamp::now();
+	//the SDK buffer can not be released while capturing
+	stopCapture();
+	detachFrameBuffer();
+	DEB_TRACE() << "TUCAM_Buf_Release";
+	Trace::begin("TUCAM_Buf_Release");
+	TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+	Trace::end("TUCAM_Buf_Release");
+	m_prepared = false;
+	double delta_time = Timestamp::now() - t0;
+	DEB_TRACE() << "Buf_Release = " << (int) (delta_time * 1000) << " (ms)";
+}
+
+//-----------------------------------------------------
+// @brief attach the Lima buffer of frame_nb to the SDK, the next frame will be written into it
+//-----------------------------------------------------
+bool Camera::attachFrameBuffer(int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj.getBuffer();
+	void* bptr = buffer_mgr.getFrameBufferPtr(frame_nb);
+	if (TUCAMRET_SUCCESS != TUCAM_Buf_Attach(m_opCam.hIdxTUCam, (PUCHAR) bptr, m_frame.uiImgSize))
+	{
+		DEB_WARNING() << "TUCAM_Buf_Attach failed, zero-copy disabled";
+		detachFrameBuffer();
+		m_zero_copy_active = false;
+		return false;
+	}
+	m_attached_ptr = bptr;
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief give back to the SDK its own frame buffer
+//-----------------------------------------------------
+void Camera::detachFrameBuffer()
+{
+	DEB_MEMBER_FUNCT();
+	if (m_attached_ptr)
+	{
+		TUCAM_Buf_Detach(m_opCam.hIdxTUCam);
+		m_attached_ptr = NULL;
+	}
+}
+
+//-----------------------------------------------------
+// @brief queue a grabbed frame for the delivery thread
+//-----------------------------------------------------
+bool Camera::pushFrame(const FrameDesc& frame)
+{
+	DEB_MEMBER_FUNCT();
+	if (!m_frame_queue.push(frame))
+	{
+		DEB_ERROR() << "Frame queue is full, frame " << frame.frame_nb << " is lost";
+		return false;
+	}
+	//take the lock only if the delivery thread is sleeping
+	if (m_delivery_waiting)
+	{
+		AutoMutex aLock(m_delivery_cond.mutex());
+		m_delivery_cond.broadcast();
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief wait until the frame the SDK is going to reuse has been delivered
+//-----------------------------------------------------
+bool Camera::waitQueueRoom()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_delivery_cond.mutex());
+	while (m_grab_frame_nb - m_acq_frame_nb >= m_frame_queue.capacity() && !m_wait_flag && !m_delivery_stopped)
+	{
+		m_grab_waiting = true;
+		TraceScope trace("wait queue room");
+		m_delivery_cond.wait();
+	}
+	m_grab_waiting = false;
+	return !m_wait_flag && !m_delivery_stopped;
+}
+
+//-----------------------------------------------------
+// @brief no more frames will be queued, wait for the delivery thread to empty the queue
+//-----------------------------------------------------
+void Camera::waitDeliveryDone()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_delivery_cond.mutex());
+	m_grab_done = true;
+	m_delivery_cond.broadcast();
+	TraceScope trace("wait delivery done");
+	while (m_delivery_active)
+		m_delivery_cond.wait();
+}
+
+//-----------------------------------------------------
+// @brief grab thread : waits for the SDK frames and queues them, the copy is done by the delivery thread
+//-----------------------------------------------------
+void Camera::AcqThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	Trace::setThreadName("grab");
+	AutoMutex aLock(m_cam.m_cond.mutex());
+
+	while(!m_cam.m_quit)
+	{
+		while(m_cam.m_wait_flag && !m_cam.m_quit)
+		{
+			DEB_TRACE() << "Wait for start acquisition ...";
+			m_cam.m_thread_running = false;
+			m_cam.m_cond.broadcast();
+			m_cam.m_cond.wait();
+		}
+
+		//if quit is requested (requested only by destructor)
+		if(m_cam.m_quit)
+			return;
+
+		DEB_TRACE() << "Running ...";
+		m_cam.m_thread_running = true;
+		m_cam.m_cond.broadcast();
+		aLock.unlock();
+
+		Timestamp t0_capture = Timestamp::now();
+
+		//@BEGIN
+		DEB_TRACE() << "Capture all frames ...";
+		bool continueFlag = true;
+		while(continueFlag && (!m_cam.m_nb_frames || m_cam.m_grab_frame_nb < m_cam.m_nb_frames))
+		{
+			// Check first if acq. has been stopped (by user or by Lima through the delivery thread)
+			if(m_cam.m_wait_flag || m_cam.m_delivery_stopped)
+			{
+				DEB_TRACE() << "AcqThread has been stopped from user";
+				continueFlag = false;
+				continue;
+			}
+
+			//do not read a new frame while the slot it will use is not yet delivered
+			if(!m_cam.waitQueueRoom())
+				continue;
+
+			//set status to exposure
+			m_cam.setStatus(Camera::Exposure, false);
+
+			//wait frame from TUCAM API ...
+			if(m_cam.m_grab_frame_nb == 0)//display TRACE only once ...
+			{
+				DEB_TRACE() << "TUCAM_Buf_WaitForFrame ...";
+			}
+
+			int index_gap;
+			unsigned long long wait_start = LatencyHistogram::now();
+			bool received = m_cam.waitForFrame(index_gap);
+			m_cam.m_latency[StageSdkWait].record(LatencyHistogram::now() - wait_start);
+			if(received)
+			{
+				m_cam.m_nb_received++;
+
+				//frame already received (SDK index going back), not delivered twice
+				if(index_gap < 0)
+				{
+					DEB_WARNING() << "SDK frame " << m_cam.m_frame.uiIndex << " received twice, ignored";
+					m_cam.m_nb_duplicated++;
+					continue;
+				}
+
+				//frames lost by the SDK or the link
+				if(index_gap > 0)
+				{
+					if(!m_cam.handleDroppedFrames(index_gap))
+					{
+						continueFlag = false;
+						continue;
+					}
+					//no more room for the received frame after the blank ones
+					if(m_cam.m_nb_frames && m_cam.m_grab_frame_nb >= m_cam.m_nb_frames)
+						continue;
+				}
+
+				// Grabbing was successful, process image
+				m_cam.setStatus(Camera::Readout, false);
+
+				//the pixels are always located after the SDK frame header
+				FrameDesc frame;
+				frame.data = m_cam.m_frame.pBuffer + m_cam.m_frame.usOffset;
+				frame.size = m_cam.m_frame.uiImgSize;
+				frame.sdk_index = m_cam.m_frame.uiIndex;
+				frame.frame_nb = m_cam.m_grab_frame_nb;
+				frame.timestamp = Timestamp::now();
+				frame.received_us = LatencyHistogram::now();
+				//one trigger per frame, the exposure follows the position in the SDK sequence
+				frame.exp_time = m_cam.sequenceExposure(m_cam.m_nb_received + m_cam.m_nb_dropped - m_cam.m_nb_duplicated - 1);
+				double cam_ts;
+				if(m_cam.readHwTimestamp(cam_ts))
+					frame.hw_timestamp = m_cam.fitHwTimestamp(cam_ts, frame.timestamp);
+
+				if(m_cam.m_zero_copy_active && frame.data != (unsigned char*) m_cam.m_attached_ptr)
+				{
+					//SDK did not put the pixels at the start of the attached buffer (header in front of them)
+					DEB_WARNING() << "SDK frame data not located in the attached Lima buffer, zero-copy disabled";
+					m_cam.detachFrameBuffer();
+					m_cam.m_zero_copy_active = false;
+				}
+				//the SDK ring slot is checked after the copy, it can be reused if the delivery is late
+				frame.slot = (!m_cam.m_zero_copy_active && m_cam.m_frame.usHeader) ? m_cam.m_frame.pBuffer : NULL;
+
+				//Zero-copy : attach the next Lima buffer as soon as possible, before the next readout
+				if(m_cam.m_zero_copy_active && (!m_cam.m_nb_frames || m_cam.m_grab_frame_nb + 1 < m_cam.m_nb_frames))
+				{
+					m_cam.attachFrameBuffer(m_cam.m_grab_frame_nb + 1);
+				}
+
+				//copy and newFrameReady are done by the delivery thread
+				m_cam.pushFrame(frame);
+				m_cam.m_grab_frame_nb++;
+
+				//latency is part of the trigger period (internal trigger timer), no sleep here
+				m_cam.updateFramePeriod(frame.timestamp);
+
+				//readout is done and the next Lima buffer attached (zero-copy), the next software trigger can be sent
+				if(m_cam.m_trigger_mode == IntTrig)
+					m_cam.m_internal_trigger_timer->frameGrabbed();
+			}
+			else
+			{
+				DEB_TRACE() << "Unable to get the frame from the camera !";
+			}
+		}
+
+		//all the grabbed frames must be delivered (or dropped if stopped) before stopping
+		m_cam.waitDeliveryDone();
+
+		//
+		////DEB_TRACE() << "TUCAM SetEvent";
+		pthread_mutex_lock(&m_cam.m_hThdLock);
+		m_cam.m_signalled = true;
+		pthread_cond_signal(&m_cam.m_hThdEvent);
+		pthread_mutex_unlock(&m_cam.m_hThdLock);
+		//@END
+
+		//stopAcq only if this is not already done
+		DEB_TRACE() << "stopAcq only if this is not already done";
+		if(!m_cam.m_wait_flag)
+		{
+			////DEB_TRACE() << "stopAcq";
+			m_cam.stopAcq();
+		}
+
+		//now detector is ready
+		m_cam.setStatus(Camera::Ready, false);
+		DEB_TRACE() << "AcqThread is no more running";
+
+		Timestamp t1_capture = Timestamp::now();
+		double delta_time_capture = t1_capture - t0_capture;
+		DEB_TRACE() << "Capture all frames elapsed time = " << (int) (delta_time_capture * 1000) << " (ms)";
+		double target_ms, mean_ms, max_error_ms;
+		m_cam.getFramePeriod(target_ms, mean_ms, max_error_ms);
+		DEB_TRACE() << "Frame period = " << mean_ms << " (ms), target = " << target_ms << " (ms), max error = " << max_error_ms << " (ms)";
+
+		aLock.lock();
+		m_cam.m_thread_running = false;
+		m_cam.m_wait_flag = true;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::AcqThread::AcqThread(Camera& cam):
+m_cam(cam)
+{
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_wait_flag = true;
+	m_cam.m_quit = false;
+	aLock.unlock();
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::AcqThread::~AcqThread()
+{
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_wait_flag = true;
+	m_cam.m_quit = true;
+	m_cam.m_cond.broadcast();
+	aLock.unlock();
+	join();
+}
+
+//-----------------------------------------------------
+// @brief telemetry thread : samples the camera every m_telemetry_period, at most every TELEMETRY_ACQ_PERIOD during acquisitions
+//-----------------------------------------------------
+void Camera::TelemetryThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	Trace::setThreadName("telemetry");
+	//lowest priority, the sampling must not delay the acquisition threads
+	struct sched_param param;
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+	AutoMutex aLock(m_cam.m_telemetry_cond.mutex());
+	Timestamp last_sample;
+
+	while(!m_cam.m_telemetry_quit)
+	{
+		//no sampling before the camera is opened, woken up by endInit
+		if(m_cam.m_telemetry_period <= 0 || !m_cam.m_init_done.load() || !m_cam.m_init_error.empty())
+		{
+			m_cam.m_telemetry_cond.wait();
+			continue;
+		}
+		double period = m_cam.m_telemetry_period;
+		if(m_cam.m_status.load() != Camera::Ready)
+			period = std::max(period, TELEMETRY_ACQ_PERIOD);
+		//the period can change or the acquisition end while waiting, wake up every second to check
+		double remaining = last_sample.isSet() ? double(last_sample) + period - double(Timestamp::now()) : 0.;
+		if(remaining > 0)
+		{
+			m_cam.m_telemetry_cond.wait(std::min(remaining, 1.));
+			continue;
+		}
+
+		last_sample = Timestamp::now();
+		aLock.unlock();
+		m_cam.sampleTelemetry();
+		aLock.lock();
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::TelemetryThread::TelemetryThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::TelemetryThread::~TelemetryThread()
+{
+	AutoMutex aLock(m_cam.m_telemetry_cond.mutex());
+	m_cam.m_telemetry_quit = true;
+	m_cam.m_telemetry_cond.broadcast();
+	aLock.unlock();
+	join();
+}
+
+//-----------------------------------------------------
+// @brief delivery thread : copies the queued frames into the Lima buffers and calls newFrameReady
+//-----------------------------------------------------
+void Camera::DeliveryThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	Trace::setThreadName("delivery");
+	AutoMutex aLock(m_cam.m_delivery_cond.mutex());
+	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj.getBuffer();
+
+	while(!m_cam.m_delivery_quit)
+	{
+		while(!m_cam.m_delivery_active && !m_cam.m_delivery_quit)
+		{
+			DEB_TRACE() << "Wait for start acquisition ...";
+			m_cam.m_delivery_cond.wait();
+		}
+
+		//if quit is requested (requested only by destructor)
+		if(m_cam.m_delivery_quit)
+			return;
+
+		DEB_TRACE() << "Running ...";
+		FrameDesc frame;
+		while(true)
+		{
+			if(!m_cam.m_frame_queue.pop(frame))
+			{
+				//the grab thread is done only after its last push
+				if(m_cam.m_grab_done && m_cam.m_frame_queue.empty())
+					break;
+				m_cam.m_delivery_waiting = true;
+				if(m_cam.m_frame_queue.empty() && !m_cam.m_grab_done)
+				{
+					TraceScope trace("wait frame");
+					m_cam.m_delivery_cond.wait();
+				}
+				m_cam.m_delivery_waiting = false;
+				continue;
+			}
+			aLock.unlock();
+
+			//frames still queued when the acquisition is stopped are dropped
+			if(!m_cam.m_wait_flag && !m_cam.m_delivery_stopped)
+			{
+				//Prepare Lima Frame Ptr
+				void* bptr = buffer_mgr.getFrameBufferPtr(frame.frame_nb);
+
+				//Copy Frame into Lima Frame Ptr (no copy if the SDK wrote directly into it)
+				if(!m_cam.readFrame(frame, bptr) && m_cam.m_drop_policy == DropFault)
+				{
+					DEB_ERROR() << "Frame overwritten in the SDK ring, acquisition stopped";
+					m_cam.setStatus(Camera::Fault, true);
+					m_cam.m_delivery_stopped = true;
+					TUCAM_Buf_AbortWait(m_cam.m_opCam.hIdxTUCam);
+					aLock.lock();
+					m_cam.m_delivery_cond.broadcast();
+					continue;
+				}
+
+				//Push the image buffer through Lima
+				////DEB_TRACE() << "Declare a Lima new Frame Ready (" << frame.frame_nb << ")";
+				HwFrameInfoType frame_info;
+				frame_info.acq_frame_nb = frame.frame_nb;
+				//camera timestamp if available, otherwise set by Lima at newFrameReady
+				if(frame.hw_timestamp.isSet())
+					frame_info.frame_timestamp = double(frame.hw_timestamp) - double(m_cam.m_start_ts);
+				//HwFrameInfoType has no exposure, it is readable by getFrameExposure once the frame is ready
+				m_cam.recordFrameExposure(frame.frame_nb, frame.exp_time);
+				unsigned long long ready_start = LatencyHistogram::now();
+				Trace::begin("newFrameReady");
+				bool more_frames = buffer_mgr.newFrameReady(frame_info);
+				Trace::end("newFrameReady");
+				unsigned long long ready_end = LatencyHistogram::now();
+				m_cam.m_latency[StageNewFrameReady].record(ready_end - ready_start);
+				m_cam.m_latency[StageDelivery].record(ready_end - frame.received_us);
+				if(!more_frames)
+				{
+					//Lima does not want more frames, unblock the grab thread
+					m_cam.m_delivery_stopped = true;
+					TUCAM_Buf_AbortWait(m_cam.m_opCam.hIdxTUCam);
+				}
+				m_cam.m_acq_frame_nb++;
+			}
+
+			aLock.lock();
+			if(m_cam.m_grab_waiting)
+				m_cam.m_delivery_cond.broadcast();
+		}
+
+		DEB_TRACE() << "DeliveryThread is no more running";
+		m_cam.m_delivery_active = false;
+		m_cam.m_delivery_cond.broadcast();
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::DeliveryThread::DeliveryThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::DeliveryThread::~DeliveryThread()
+{
+	AutoMutex aLock(m_cam.m_delivery_cond.mutex());
+	m_cam.m_delivery_quit = true;
+	m_cam.m_delivery_cond.broadcast();
+	aLock.unlock();
+	join();
+}
+
+//-----------------------------------------------------
+// @brief the init errors are kept for waitInitDone, status is Fault
+//-----------------------------------------------------
+void Camera::InitThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	Trace::setThreadName("init");
+	std::string error;
+	try
+	{
+		m_cam.initialize();
+	}
+	catch(Exception& e)
+	{
+		error = e.getErrMsg();
+	}
+	catch(std::exception& e)
+	{
+		error = e.what();
+	}
+	catch(...)
+	{
+		error = "unknown error";
+	}
+	m_cam.endInit(error);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::InitThread::InitThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+// @brief the SDK calls can not be aborted, wait for the end of the init
+//-----------------------------------------------------
+Camera::InitThread::~InitThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getImageType(ImageType& type)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Fix the image type (pixel depth) into Driver/API		
+	switch(m_depth)
+	{
+		case 8: type = Bpp8;
+			break;
+		case 12: type = Bpp12;
+			break;
+		case 16: type = Bpp16;
+			break;
+		default:
+			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 8, 12 and 16 bits are managed!";
+			break;
+	}
+	//@END	
+	return;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setImageType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	DEB_TRACE() << "setImageType - " << DEB_VAR1(type);
+	//@BEGIN : Fix the image type (pixel depth) into Driver/API	
+	long depth;
+	switch(type)
+	{
+		case Bpp8:
+			depth = 8;
+			break;
+		case Bpp12:
+			if(m_img_mode_12 < 0)
+			{
+				THROW_HW_ERROR(NotSupported) << "This camera has no 12 bits mode !";
+			}
+			depth = 12;
+			break;
+		case Bpp16:
+			depth = 16;
+			break;
+		default:
+			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 8, 12 and 16 bits are managed!";
+			break;
+	}
+	if(depth == m_depth)
+		return;
+
+	//SDK buffer must be allocated after the readout mode is changed
+	releaseSdkBuffer();
+	//12 bits is an image mode with 16 bits pixels, 8 bits is an output depth of the other modes
+	int img_mode = (depth == 12) ? m_img_mode_12 : m_img_mode_16;
+	if(m_img_mode_12 >= 0 && TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_IMGMODESELECT, img_mode))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_IMGMODESELECT to the camera !";
+	}
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, (depth == 8) ? 8 : 16))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_BITOFDEPTH to the camera !";
+	}
+	m_depth = depth;
+	//@END	
+}
+
+//-----------------------------------------------------
+// @brief find the 12 bits image mode (its text contains "12"), the current mode is used for 8 and 16 bits
+//-----------------------------------------------------
+void Camera::initImageType()
+{
+	DEB_MEMBER_FUNCT();
+	TUCAM_CAPA_ATTR attrCapa;
+	attrCapa.idCapa = TUIDC_IMGMODESELECT;
+	if(TUCAMRET_SUCCESS == TUCAM_Capa_GetAttr(m_opCam.hIdxTUCam, &attrCapa))
+	{
+		int mode = attrCapa.nValDft;
+		TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_IMGMODESELECT, &mode);
+		for(int value = attrCapa.nValMin; value <= attrCapa.nValMax; value++)
+		{
+			char text[64] = {0};
+			TUCAM_VALUE_TEXT valText;
+			valText.nID = TUIDC_IMGMODESELECT;
+			valText.dbValue = value;
+			valText.pText = text;
+			valText.nTextSize = sizeof(text);
+			if(TUCAMRET_SUCCESS == TUCAM_Capa_GetValueText(m_opCam.hIdxTUCam, &valText) && strstr(text, "12"))
+			{
+				m_img_mode_12 = value;
+				DEB_TRACE() << "12 bits image mode : " << text << " = " << value;
+				break;
+			}
+		}
+		//the camera may have been left in 12 bits mode
+		m_img_mode_16 = (mode == m_img_mode_12) ? attrCapa.nValDft : mode;
+		if(m_img_mode_12 >= 0 && m_img_mode_16 == m_img_mode_12)
+			m_img_mode_16 = (m_img_mode_12 == attrCapa.nValMin) ? attrCapa.nValMax : attrCapa.nValMin;
+		TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_IMGMODESELECT, m_img_mode_16);
+	}
+	else
+	{
+		DEB_TRACE() << "No TUIDC_IMGMODESELECT, no 12 bits mode";
+	}
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, 16))
+	{
+		DEB_WARNING() << "Unable to Write TUIDC_BITOFDEPTH to the camera !";
+	}
+	m_depth = 16;
+	DEB_TRACE() << DEB_VAR2(m_img_mode_12, m_img_mode_16);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorType(std::string& type)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Detector type from Driver/API
+	type = "Tucsen - Dhyana";
+	//@END	
+
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorModel(std::string& model)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	//@BEGIN : Get Detector model/type from Driver/API
+	if(m_prop_cache.get(PropModel, model))
+		return;
+	stringstream ss;
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_CAMERA_MODEL;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_CAMERA_MODEL from the camera !";
+	}
+	ss << valInfo.pText;
+	model = ss.str();
+	m_prop_cache.set(PropModel, model);
+	//@END		
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorImageSize(Size& size)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : Get Detector size in pixels from Driver/API
+	size = Size(PIXEL_NB_WIDTH, PIXEL_NB_HEIGHT);
+	//@END
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getPixelSize(double& sizex, double& sizey)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Pixels size in micron from Driver/API			
+	sizex = PIXEL_SIZE_WIDTH_MICRON*1e-6;
+	sizey = PIXEL_SIZE_HEIGHT_MICRON*1e-6;
+	//@END
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+HwBufferCtrlObj* Camera::getBufferCtrlObj()
+{
+	return &m_bufferCtrlObj;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::checkTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	bool valid_mode;
+	//@BEGIN
+	switch(mode)
+	{
+		case IntTrig:
+		case ExtTrigMult:
+		case ExtTrigSingle:
+		case ExtGate:
+			valid_mode = true;
+			break;
+		case ExtTrigReadout:
+		case IntTrigMult:
+		default:
+			valid_mode = false;
+			break;
+	}
+	//@END
+	return valid_mode;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setTrigMode() " << DEB_VAR1(mode);
+	DEB_PARAM() << DEB_VAR1(mode);
+	//@BEGIN
+
+	m_trigger_mode = mode;
+	//@END
+
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getTrigMode(TrigMode& mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_trigger_mode;
+	DEB_RETURN() << DEB_VAR1(mode);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getExpTime(double& exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	//@BEGIN
+	//the camera has the exposure of the sequence, m_exp_time is written back by stopAcq
+	if(m_exp_sequence_active)
+	{
+		exp_time = m_exp_time;
+		DEB_RETURN() << DEB_VAR1(exp_time);
+		return;
+	}
+	double dbVal;
+	if(!m_prop_cache.get(PropExpTime, dbVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, &dbVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDP_EXPOSURETM from the camera !";
+		}
+		m_prop_cache.set(PropExpTime, dbVal);
+	}
+	//rounded by the camera, m_exp_time keeps the value asked by setExpTime
+	exp_time = dbVal / 1000;//TUCAM use (ms), but lima use (second) as unit 
+	//@END
+	DEB_RETURN() << DEB_VAR1(exp_time);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setExpTime(double exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	DEB_TRACE() << "setExpTime() " << DEB_VAR1(exp_time);
+	//@BEGIN
+	//the trigger thread owns the camera exposure during a sequence, stopAcq writes this one
+	if(m_exp_sequence_active)
+	{
+		m_exp_time = exp_time;
+		return;
+	}
+	//the camera rounds the exposure, it is read back once by the next getExpTime
+	m_prop_cache.invalidate(PropExpTime);
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_time * 1000))//TUCAM use (ms), but lima use (second) as unit 
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_EXPOSURETM to the camera !";
+	}
+	//@END
+	m_exp_time = exp_time;
+}
+
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setLatTime(double lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setLatTime() " << DEB_VAR1(lat_time);
+	m_lat_time = lat_time;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatTime(double& lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	//@END
+	lat_time = m_lat_time;
+	DEB_RETURN() << DEB_VAR1(lat_time);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getExposureTimeRange(double& min_expo, double& max_expo) const
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	min_expo = 0.;
+	max_expo = 10;//10s
+	//@END
+	DEB_RETURN() << DEB_VAR2(min_expo, max_expo);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatTimeRange(double& min_lat, double& max_lat) const
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	// --- no info on min latency
+	min_lat = 0.;
+	// --- do not know how to get the max_lat, fix it as the max exposure time
+	max_lat = 10;//10s
+	//@END
+	DEB_RETURN() << DEB_VAR2(min_lat, max_lat);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setNbFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setNbFrames() " << DEB_VAR1(nb_frames);
+	//@BEGIN
+	if(nb_frames < 0)
+	{
+		THROW_HW_ERROR(Error) << "Number of frames to acquire has not been set";
+	}
+	if(nb_frames > 1)
+	{
+		//THROW_HW_ERROR(Error) << "Unable to acquire more than 1 frame ! ";	//T@D@ allowed only for test 
+	}
+	//@END
+	m_nb_frames = nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getNbFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_RETURN() << DEB_VAR1(m_nb_frames);
+	//@BEGIN
+	//@END
+	nb_frames = m_nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+int Camera::getNbHwAcquiredFrames()
+{
+	DEB_MEMBER_FUNCT();
+	return m_acq_frame_nb;
+}
+
+//-----------------------------------------------------
+// @brief range the binning to the maximum allowed
+//-----------------------------------------------------
+void Camera::checkBin(Bin &hw_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : check available values of binning H/V
+	//factors not done by the camera are done in software, up to SW_BIN_MAX
+	int x = std::min(std::max(hw_bin.getX(), 1), SW_BIN_MAX);
+	int y = std::min(std::max(hw_bin.getY(), 1), SW_BIN_MAX);
+	//no software binning in 8 bits (see prepareAcq), only the factors of the camera
+	if(m_depth == 8 && !m_hw_bin_values[m_bin_mode].count(std::make_pair(x, y)))
+		x = y = 1;
+	//@END
+
+	hw_bin = Bin(x, y);
+	DEB_RETURN() << DEB_VAR1(hw_bin);
+}
+//-----------------------------------------------------
+// @brief set the new binning mode
+//-----------------------------------------------------
+void Camera::setBin(const Bin &set_bin)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+
+	//@BEGIN : set binning H/V to the Driver/API
+	//SDK buffer must be allocated after set binning
+	if(set_bin != m_bin)
+		releaseSdkBuffer();
+	applyBin(set_bin);
+	//@END
+	m_bin = set_bin;
+
+	DEB_RETURN() << DEB_VAR1(set_bin);
+}
+
+//-----------------------------------------------------
+// @brief return the current binning mode
+//-----------------------------------------------------
+void Camera::getBin(Bin &hw_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : get binning from Driver/API
+	int bin_x = m_bin.getX();
+	int bin_y = m_bin.getY();
+	//@END
+	Bin tmp_bin(bin_x, bin_y);
+
+	hw_bin = tmp_bin;
+
+	DEB_RETURN() << DEB_VAR1(hw_bin);
+}
+
+//-----------------------------------------------------
+// @brief read the binning factors of TUIDC_BINNING_SUM and TUIDC_BINNING_AVG, their text is like "2x2"
+//-----------------------------------------------------
+void Camera::initBinning()
+{
+	DEB_MEMBER_FUNCT();
+	const int capas[2] = {TUIDC_BINNING_SUM, TUIDC_BINNING_AVG};
+	for(int mode = BinSum; mode <= BinAvg; mode++)
+	{
+		m_hw_bin_values[mode].clear();
+		TUCAM_CAPA_ATTR attrCapa;
+		attrCapa.idCapa = capas[mode];
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetAttr(m_opCam.hIdxTUCam, &attrCapa))
+		{
+			DEB_TRACE() << "No hardware binning for mode " << mode;
+			continue;
+		}
+		for(int value = attrCapa.nValMin; value <= attrCapa.nValMax; value++)
+		{
+			char text[64] = {0};
+			TUCAM_VALUE_TEXT valText;
+			valText.nID = capas[mode];
+			valText.dbValue = value;
+			valText.pText = text;
+			valText.nTextSize = sizeof(text);
+			int x, y;
+			if(TUCAMRET_SUCCESS == TUCAM_Capa_GetValueText(m_opCam.hIdxTUCam, &valText) &&
+			   sscanf(text, "%d%*[xX*]%d", &x, &y) == 2)
+			{
+				m_hw_bin_values[mode][std::make_pair(x, y)] = value;
+				DEB_TRACE() << "Hardware binning " << x << "x" << y << " (mode " << mode << ") = " << value;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------
+// @brief binning done by the camera if it can, in software otherwise
+//-----------------------------------------------------
+void Camera::applyBin(const Bin& bin)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(bin);
+	const int capas[2] = {TUIDC_BINNING_SUM, TUIDC_BINNING_AVG};
+	std::map<std::pair<int, int>, int>& values = m_hw_bin_values[m_bin_mode];
+	std::map<std::pair<int, int>, int>::iterator it = values.find(std::make_pair(bin.getX(), bin.getY()));
+	bool hw = (it != values.end());
+
+	//leave the hardware binning of both modes if it is not used
+	for(int mode = BinSum; mode <= BinAvg; mode++)
+	{
+		if(hw && mode == m_bin_mode)
+			continue;
+		std::map<std::pair<int, int>, int>::iterator no_bin = m_hw_bin_values[mode].find(std::make_pair(1, 1));
+		if(m_hw_bin != Bin(1, 1) && no_bin != m_hw_bin_values[mode].end())
+			TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, capas[mode], no_bin->second);
+	}
+	if(hw && TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, capas[m_bin_mode], it->second))
+	{
+		DEB_WARNING() << "Unable to set hardware binning " << bin << ", done in software";
+		hw = false;
+	}
+	m_hw_bin = hw ? bin : Bin(1, 1);
+	m_sw_bin = hw ? Bin(1, 1) : bin;
+	//the camera roi unit follows the hardware binning, it must be written again
+	m_roi_attr_valid = false;
+	DEB_TRACE() << DEB_VAR2(m_hw_bin, m_sw_bin);
+}
+
+//-----------------------------------------------------
+// @brief ROI constraints of the camera, ROI_ALIGNMENT for every model
+//-----------------------------------------------------
+void Camera::initRoiAlignment()
+{
+	DEB_MEMBER_FUNCT();
+	std::string model;
+	getDetectorModel(model);
+	m_roi_align = ROI_ALIGNMENT;
+	DEB_TRACE() << model << " roi steps : x " << m_roi_align.x_step << ", y " << m_roi_align.y_step
+				<< ", width " << m_roi_align.width_step << ", height " << m_roi_align.height_step;
+}
+
+//-----------------------------------------------------
+// greatest common divisor
+//-----------------------------------------------------
+static int gcd(int a, int b)
+{
+	while(b)
+	{
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+//-----------------------------------------------------
+// @brief round down offset, round up size, both to their step, and keep [offset, offset + size[ inside [0, max[
+//-----------------------------------------------------
+static void alignAxis(int& offset, int& size, int offset_step, int size_step, int max)
+{
+	int end = offset + size;
+	offset -= offset % offset_step;
+	size = end - offset;
+	size += (size_step - size % size_step) % size_step;
+	if(offset + size > max)
+	{
+		//move the roi back inside the detector, full size if it does not fit
+		offset = std::max(0, max - size);
+		offset -= offset % offset_step;
+		size = std::min(size, max - offset);
+	}
+}
+
+//-----------------------------------------------------
+// @brief smallest roi containing set_roi that the camera does not round, in Lima (binned) pixels
+//-----------------------------------------------------
+void Camera::alignRoi(const Roi& set_roi, Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	//the steps are in camera pixels, Lima pixels are m_sw_bin camera pixels
+	int bin_x = m_sw_bin.getX();
+	int bin_y = m_sw_bin.getY();
+	Size size;
+	getDetectorImageSize(size);
+	int max_x = size.getWidth() / m_bin.getX();
+	int max_y = size.getHeight() / m_bin.getY();
+
+	int x = set_roi.getTopLeft().x;
+	int y = set_roi.getTopLeft().y;
+	int width = set_roi.getSize().getWidth();
+	int height = set_roi.getSize().getHeight();
+	alignAxis(x, width,
+			  m_roi_align.x_step / gcd(m_roi_align.x_step, bin_x),
+			  m_roi_align.width_step / gcd(m_roi_align.width_step, bin_x), max_x);
+	alignAxis(y, height,
+			  m_roi_align.y_step / gcd(m_roi_align.y_step, bin_y),
+			  m_roi_align.height_step / gcd(m_roi_align.height_step, bin_y), max_y);
+	hw_roi = Roi(x, y, width, height);
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//-----------------------------------------------------
+//! Camera::checkRoi()
+//-----------------------------------------------------
+void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "checkRoi";
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	//@BEGIN : check available values of Roi
+	if(set_roi.isActive())
+	{
+		//smallest camera roi containing set_roi, Lima does the sub roi
+		alignRoi(set_roi, hw_roi);
+	}
+	else
+	{
+		hw_roi = set_roi;
+	}
+	//@END
+
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::getRoi()
+//---------------------------------------------------------------------------------------
+void Camera::getRoi(Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	//@BEGIN : get Roi from the Driver/API
+	TUCAM_ROI_ATTR roiAttr;
+	if(TUCAMRET_SUCCESS != TUCAM_Cap_GetROI(m_opCam.hIdxTUCam, &roiAttr))
+	{
+		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
+	}
+	//with software binning the camera roi is in sensor pixels, Lima roi in binned pixels
+	int bin_x = m_sw_bin.getX();
+	int bin_y = m_sw_bin.getY();
+	hw_roi = Roi(roiAttr.nHOffset / bin_x,
+				roiAttr.nVOffset / bin_y,
+				roiAttr.nWidth / bin_x,
+				roiAttr.nHeight / bin_y);
+	//@END
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::setRoi()
+//---------------------------------------------------------------------------------------
+void Camera::setRoi(const Roi& set_roi)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	DEB_TRACE() << "setRoi";
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	//@BEGIN : set Roi from the Driver/API	
+	//Lima roi is in binned pixels, full frame is the binned detector size
+	Size size;
+	getDetectorImageSize(size);
+	size = Size(size.getWidth() / m_bin.getX(), size.getHeight() / m_bin.getY());
+	Roi new_roi = set_roi.isActive() ? set_roi : Roi(0, 0, size.getWidth(), size.getHeight());
+	//camera roi : binned pixels with hardware binning, sensor pixels with software binning
+	int bin_x = m_sw_bin.getX();
+	int bin_y = m_sw_bin.getY();
+	DEB_TRACE() << (set_roi.isActive() ? "Roi is Enabled" : "Roi is not Enabled : so set full frame");
+	TUCAM_ROI_ATTR roiAttr;
+	roiAttr.bEnable = TRUE;
+	roiAttr.nHOffset = new_roi.getTopLeft().x * bin_x;
+	roiAttr.nVOffset = new_roi.getTopLeft().y * bin_y;
+	roiAttr.nWidth = new_roi.getSize().getWidth() * bin_x;
+	roiAttr.nHeight = new_roi.getSize().getHeight() * bin_y;
+
+	//the same roi is not sent again to the camera
+	if(m_roi_attr_valid &&
+	   roiAttr.nHOffset == m_roi_attr.nHOffset && roiAttr.nVOffset == m_roi_attr.nVOffset &&
+	   roiAttr.nWidth == m_roi_attr.nWidth && roiAttr.nHeight == m_roi_attr.nHeight)
 	{
-		case Bpp16:
-			m_depth = 16;
-			break;
-		default:
-			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
-			break;
+		DEB_TRACE() << "Roi is unchanged";
+		m_roi = new_roi;
+		return;
+	}
+
+	//SDK buffer must be allocated after set ROI attribute
+	releaseSdkBuffer();
+	m_roi_attr_valid = false;
+	//set Roi to Driver/API
+	if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
+	{
+		THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
 	}
+	m_roi_attr = roiAttr;
+	m_roi_attr_valid = true;
+	m_roi = new_roi;
 	//@END	
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getDetectorType(std::string& type)
+bool Camera::isAcqRunning() const
+{
+	DEB_MEMBER_FUNCT();
+	//	AutoMutex aLock(m_cond.mutex());
+	bool running = m_thread_running.load();
+	DEB_TRACE() << "isAcqRunning - " << DEB_VAR1(running) << "---------------------------";
+	return running;
+}
+
+///////////////////////////////////////////////////////
+// Dhyana specific stuff now
+///////////////////////////////////////////////////////
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setTemperatureTarget(double temp)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	TUCAM_PROP_ATTR attrProp;
+	attrProp.nIdxChn = 0;// Current channel (camera monochrome = 0) . VERY IMPORTANT, doesn't work otherwise !!!!!
+	attrProp.idProp = TUIDP_TEMPERATURE;
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetAttr(m_opCam.hIdxTUCam, &attrProp))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE range from the camera !";
+	}
+	DEB_TRACE() << "Temperature range [" << (int) attrProp.dbValMin << " , " << (int) attrProp.dbValMax << "]";
+
+	int temp_middle = (int) attrProp.dbValMax / 2;
+	if(((int) temp + temp_middle)<((int) attrProp.dbValMin) || ((int) temp + temp_middle)>((int) attrProp.dbValMax))
+	{
+		THROW_HW_ERROR(Error) << "Unable to set the Temperature Target !\n"
+		 << "It is out of range : "
+		 << "["
+		 << (int) attrProp.dbValMin - temp_middle
+		 << ","
+		 << (int) attrProp.dbValMax - temp_middle
+		 << "]";
+	}
+
+	int nVal = (int) temp + temp_middle;//temperatureTarget is a delta according to the middle temperature !!
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, nVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_TEMPERATURE to the camera !";
+	}
+	m_temperature_target = (double) temp;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTemperatureTarget(double& temp)
+{
+	DEB_MEMBER_FUNCT();
+
+	temp = m_temperature_target;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTemperature(double& temp)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+
+	double dbVal = 0.0f;
+	//last sample of the telemetry thread if it runs
+	{
+		AutoMutex aLock(m_telemetry_cond.mutex());
+		if(m_telemetry_period > 0 && m_telemetry_nb > 0)
+		{
+			temp = m_telemetry_history[(m_telemetry_nb - 1) % TELEMETRY_HISTORY_SIZE].temperature;
+			return;
+		}
+	}
+	//read again after the temperature refresh period
+	if(!m_prop_cache.get(PropTemperature, dbVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE from the camera !";
+		}
+		m_prop_cache.set(PropTemperature, dbVal);
+	}
+	temp = dbVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setFanSpeed(unsigned speed)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+
+	int nVal = (int) speed;
+
+	m_prop_cache.invalidate(PropFanSpeed);
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, nVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_FAN_GEAR to the camera !";
+	}
+	m_prop_cache.set(PropFanSpeed, nVal);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getFanSpeed(unsigned& speed)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+
+	double dbVal;
+	if(!m_prop_cache.get(PropFanSpeed, dbVal))
+	{
+		int nVal;
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDC_FAN_GEAR from the camera !";
+		}
+		dbVal = nVal;
+		m_prop_cache.set(PropFanSpeed, dbVal);
+	}
+	speed = (unsigned) dbVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setGlobalGain(TucamGain gain)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+
+	double dbVal = (double) gain;
+	m_prop_cache.invalidate(PropGlobalGain);
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, dbVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_GLOBALGAIN to the camera !";
+	}
+	m_prop_cache.set(PropGlobalGain, dbVal);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getGlobalGain(TucamGain& gain)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+
+	double dbVal;
+	if(!m_prop_cache.get(PropGlobalGain, dbVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, &dbVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDP_GLOBALGAIN from the camera !";
+		}
+		m_prop_cache.set(PropGlobalGain, dbVal);
+	}
+	gain = (TucamGain)dbVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getTucamVersion(std::string& version)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	if(m_prop_cache.get(PropTucamVersion, version))
+		return;
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_VERSION_API;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_API from the camera !";
+	}
+	version = valInfo.pText;
+	m_prop_cache.set(PropTucamVersion, version);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getFirmwareVersion(std::string& version)
+{
+	DEB_MEMBER_FUNCT();
+	waitInitDone();
+	if(m_prop_cache.get(PropFirmwareVersion, version))
+		return;
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_VERSION_FRMW;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_FRMW from the camera !";
+	}
+	version = valInfo.pText;
+	m_prop_cache.set(PropFirmwareVersion, version);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getCameraIndex(int& index)
+{
+	DEB_MEMBER_FUNCT();
+	index = m_camera_index;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getSerialNumber(std::string& serial)
+{
+	DEB_MEMBER_FUNCT();
+	serial = m_serial_number;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge, int delay, int width)
+{
+  DEB_MEMBER_FUNCT();
+  waitInitDone();
+  TUCAM_TRGOUT_ATTR tgroutAttr;
+
+  if (port <0 || port >2)
+    {
+      THROW_HW_ERROR(Error) << "Invalid output port number range is [0-2]";
+
+    }
+  tgroutAttr.nTgrOutPort = port;
+  tgroutAttr.nTgrOutMode = (int)signal;
+  tgroutAttr.nEdgeMode = (int)edge;
+  tgroutAttr.nDelayTm = delay;
+  tgroutAttr.nWidth = width;
+    
+  m_outputs_valid[port] = false;
+  if(TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut (m_opCam.hIdxTUCam, tgroutAttr))
+    {
+      THROW_HW_ERROR(Error) << "Unable to set Output signal port "<< port;
+    }
+  //-1 keeps the current delay or width, read it back next time
+  if (delay >= 0 && width >= 0)
+    {
+      OutputSignal output = {signal, edge, delay, width};
+      m_outputs[port] = output;
+      m_outputs_valid[port] = true;
+    }
+}
+
+void Camera::getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width)
+{
+  DEB_MEMBER_FUNCT();
+  waitInitDone();
+  TUCAM_TRGOUT_ATTR tgroutAttr;
+
+  if (port <0 || port >2)
+    {
+      THROW_HW_ERROR(Error) << "Invalid output port number range is [0-2]";
+    }
+  if (!m_outputs_valid[port])
+    {
+      tgroutAttr.nTgrOutPort = port;
+
+      if(TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut (m_opCam.hIdxTUCam, &tgroutAttr))
+	{
+	  THROW_HW_ERROR(Error) << "Unable to get Output signal port "<< port;
+	}  
+      OutputSignal output = {(TucamSignal) tgroutAttr.nTgrOutMode, (TucamSignalEdge) tgroutAttr.nEdgeMode,
+			     tgroutAttr.nDelayTm, tgroutAttr.nWidth};
+      m_outputs[port] = output;
+      m_outputs_valid[port] = true;
+    }
+  signal = m_outputs[port].signal;
+  edge = m_outputs[port].edge;
+  delay = m_outputs[port].delay;
+  width = m_outputs[port].width;
+}
+
+//-----------------------------------------------------
+// @brief enable the zero-copy mode, the SDK writes the frames directly into the Lima buffers.
+// If the SDK frame does not match the Lima frame, the copy mode is used as fallback.
+//-----------------------------------------------------
+void Camera::setZeroCopy(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_zero_copy = enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getZeroCopy(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_zero_copy;
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+// @brief highest number of frames waiting for the delivery thread during the last acquisition
+//-----------------------------------------------------
+void Camera::getQueueHighWaterMark(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_frame_queue.getHighWaterMark();
+	DEB_RETURN() << DEB_VAR1(nb_frames);
+}
+
+//-----------------------------------------------------
+// @brief nb of prepareAcq which reused the SDK buffer of the previous acquisition
+//-----------------------------------------------------
+void Camera::getBufferCacheHits(int& nb_hits)
+{
+	DEB_MEMBER_FUNCT();
+	nb_hits = m_buffer_cache_hits;
+	DEB_RETURN() << DEB_VAR1(nb_hits);
+}
+
+//-----------------------------------------------------
+// @brief nb of prepareAcq which had to allocate the SDK buffer
+//-----------------------------------------------------
+void Camera::getBufferCacheMisses(int& nb_misses)
+{
+	DEB_MEMBER_FUNCT();
+	nb_misses = m_buffer_cache_misses;
+	DEB_RETURN() << DEB_VAR1(nb_misses);
+}
+
+//-----------------------------------------------------
+// @brief delay (ms) between TUCAM_Cap_Start and the first trigger accepted by the camera
+//-----------------------------------------------------
+void Camera::getArmLatency(double& latency_ms)
+{
+	DEB_MEMBER_FUNCT();
+	latency_ms = m_arm_latency;
+	DEB_RETURN() << DEB_VAR1(latency_ms);
+}
+
+//-----------------------------------------------------
+// @brief sum or average of the binned pixels, for hardware and software binning
+//-----------------------------------------------------
+void Camera::setBinMode(BinMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(mode);
+	if(mode == m_bin_mode)
+		return;
+	//the camera may do the current binning in one mode and not in the other one
+	releaseSdkBuffer();
+	m_bin_mode = mode;
+	applyBin(m_bin);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getBinMode(BinMode& mode)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Detector type from Driver/API
-	type = "Tucsen - Dhyana";
-	//@END	
+	mode = m_bin_mode;
+	DEB_RETURN() << DEB_VAR1(mode);
+}
 
+//-----------------------------------------------------
+// @brief true if the current binning is done in software during the copy
+//-----------------------------------------------------
+void Camera::getSoftwareBinning(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = (m_sw_bin != Bin(1, 1));
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+// @brief keep the camera in capture mode between sequences with the same trigger config, internal trigger only
+//-----------------------------------------------------
+void Camera::setKeepArmed(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_keep_armed = enable;
+	if (!enable && !isAcqRunning())
+		stopCapture();
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getDetectorModel(std::string& model)
+void Camera::getKeepArmed(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Detector model/type from Driver/API
-	stringstream ss;
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_CAMERA_MODEL;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	enable = m_keep_armed;
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+// @brief acquisition thread : timestamp of the last frame from its header, in camera clock units
+//-----------------------------------------------------
+bool Camera::readHwTimestamp(double& cam_ts)
+{
+	//in zero-copy mode the SDK does not write the header
+	if(!m_hw_timestamp || m_zero_copy_active || m_frame.usHeader < sizeof(TUCAM_IMG_HEADER))
+		return false;
+	const TUCAM_IMG_HEADER* header = (const TUCAM_IMG_HEADER*) m_frame.pBuffer;
+	if(header->szSignature[0] != 'T' || header->szSignature[1] != 'U')
+		return false;
+	cam_ts = header->dblTimeStamp;
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief acquisition thread : add a camera/host pair to the linear fit, return the camera timestamp on the host clock
+// host receive times are delayed by readout and scheduling, the fit keeps the camera clock precision
+//-----------------------------------------------------
+Timestamp Camera::fitHwTimestamp(double cam_ts, const Timestamp& host_ts)
+{
+	unsigned int seq = m_ts_seq.load(std::memory_order_relaxed);
+	m_ts_seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	if(m_ts_nb == 0)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_CAMERA_MODEL from the camera !";
+		m_ts_cam0 = cam_ts;
+		m_ts_host0 = host_ts;
+		m_ts_mean_x = m_ts_mean_y = 0.;
+		m_ts_cxx = m_ts_cxy = m_ts_cyy = 0.;
 	}
-	ss << valInfo.pText;
-	model = ss.str();
-	//@END		
+	double x = cam_ts - m_ts_cam0;
+	double y = double(host_ts) - m_ts_host0;
+	m_ts_nb++;
+	double dx = x - m_ts_mean_x;
+	double dy = y - m_ts_mean_y;
+	m_ts_mean_x += dx / m_ts_nb;
+	m_ts_mean_y += dy / m_ts_nb;
+	m_ts_cxx += dx * (x - m_ts_mean_x);
+	m_ts_cxy += dx * (y - m_ts_mean_y);
+	m_ts_cyy += dy * (y - m_ts_mean_y);
+	m_ts_seq.store(seq + 2, std::memory_order_release);
+
+	//not enough points yet (or camera clock not running) : host time
+	if(m_ts_nb < 2 || m_ts_cxx <= 0.)
+		return host_ts;
+	double slope = m_ts_cxy / m_ts_cxx;
+	return Timestamp(m_ts_host0 + m_ts_mean_y + slope * (x - m_ts_mean_x));
 }
 
 //-----------------------------------------------------
-//
+// @brief acquisition thread : period between this frame and the previous one
 //-----------------------------------------------------
-void Camera::getDetectorImageSize(Size& size)
+void Camera::updateFramePeriod(const Timestamp& frame_ts)
 {
-	DEB_MEMBER_FUNCT();
+	if(m_grab_frame_nb > 1)
+	{
+		double period = double(frame_ts) - double(m_last_frame_ts);
+		m_latency[StageFramePeriod].record((unsigned long long) (std::max(0., period) * 1e6));
+		unsigned int seq = m_period_seq.load(std::memory_order_relaxed);
+		m_period_seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_period_sum += period;
+		m_period_nb++;
+		if(m_period_target > 0)
+			m_period_max_error = std::max(m_period_max_error, fabs(period - m_period_target));
+		m_period_seq.store(seq + 2, std::memory_order_release);
+	}
+	m_last_frame_ts = frame_ts;
+}
 
-	//@BEGIN : Get Detector size in pixels from Driver/API
-	size = Size(PIXEL_NB_WIDTH, PIXEL_NB_HEIGHT);
-	//@END
+//-----------------------------------------------------
+// @brief frame period of the last acquisition : target (exp + lat, internal trigger only), measured mean and max error
+// read without lock, the copy is retried while the acquisition thread or startAcq changes the statistics
+//-----------------------------------------------------
+void Camera::getFramePeriod(double& target_ms, double& mean_ms, double& max_error_ms)
+{
+	DEB_MEMBER_FUNCT();
+	unsigned int seq;
+	double target, sum, max_error;
+	int nb;
+	do
+	{
+		seq = m_period_seq.load(std::memory_order_acquire);
+		target = m_period_target;
+		nb = m_period_nb;
+		sum = m_period_sum;
+		max_error = m_period_max_error;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while((seq & 1) || m_period_seq.load(std::memory_order_relaxed) != seq);
+	target_ms = target * 1000;
+	mean_ms = nb ? sum / nb * 1000 : 0.;
+	max_error_ms = max_error * 1000;
+	DEB_RETURN() << DEB_VAR3(target_ms, mean_ms, max_error_ms);
 }
 
 //-----------------------------------------------------
-//
+// @brief enable the frame timestamps of the camera (TUIDC_ENABLETIMESTAMP)
 //-----------------------------------------------------
-void Camera::getPixelSize(double& sizex, double& sizey)
+void Camera::setHwTimestamp(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Pixels size in micron from Driver/API			
-	sizex = PIXEL_SIZE_WIDTH_MICRON*1e-6;
-	sizey = PIXEL_SIZE_HEIGHT_MICRON*1e-6;
-	//@END
+	waitInitDone();
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_ENABLETIMESTAMP, enable ? 1 : 0))
+	{
+		if(enable)
+			DEB_WARNING() << "Unable to enable TUIDC_ENABLETIMESTAMP, frame timestamps will be taken on the host";
+		m_hw_timestamp = false;
+		return;
+	}
+	m_hw_timestamp = enable;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-HwBufferCtrlObj* Camera::getBufferCtrlObj()
+void Camera::getHwTimestamp(bool& enable)
 {
-	return &m_bufferCtrlObj;
+	DEB_MEMBER_FUNCT();
+	enable = m_hw_timestamp;
+	DEB_RETURN() << DEB_VAR1(enable);
 }
 
 //-----------------------------------------------------
-//
+// @brief camera -> host clock fit of the last acquisition : host (s) = offset + slope * camera timestamp
+// read without lock, the copy is retried while the acquisition thread or startAcq changes the fit
 //-----------------------------------------------------
-bool Camera::checkTrigMode(TrigMode mode)
+void Camera::getTimestampFit(double& slope, double& offset, double& rms_us)
 {
 	DEB_MEMBER_FUNCT();
-	bool valid_mode;
-	//@BEGIN
-	switch(mode)
+	unsigned int seq;
+	int nb;
+	double cam0, host0, mean_x, mean_y, cxx, cxy, cyy;
+	do
 	{
-		case IntTrig:
-		case ExtTrigMult:
-		case ExtTrigSingle:
-		case ExtGate:
-			valid_mode = true;
-			break;
-		case ExtTrigReadout:
-		case IntTrigMult:
-		default:
-			valid_mode = false;
-			break;
+		seq = m_ts_seq.load(std::memory_order_acquire);
+		nb = m_ts_nb;
+		cam0 = m_ts_cam0;
+		host0 = m_ts_host0;
+		mean_x = m_ts_mean_x;
+		mean_y = m_ts_mean_y;
+		cxx = m_ts_cxx;
+		cxy = m_ts_cxy;
+		cyy = m_ts_cyy;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while((seq & 1) || m_ts_seq.load(std::memory_order_relaxed) != seq);
+	slope = offset = rms_us = 0.;
+	if(nb >= 2 && cxx > 0.)
+	{
+		slope = cxy / cxx;
+		offset = host0 + mean_y - slope * (mean_x + cam0);
+		double residual = (cyy - slope * cxy) / nb;
+		rms_us = sqrt(std::max(0., residual)) * 1e6;
 	}
-	//@END
-	return valid_mode;
+	DEB_RETURN() << DEB_VAR3(slope, offset, rms_us);
+}
+
+//-----------------------------------------------------
+// @brief what to do when the SDK frame index shows missing frames
+//-----------------------------------------------------
+void Camera::setDropPolicy(DropPolicy policy)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(policy);
+	m_drop_policy = policy;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setTrigMode(TrigMode mode)
+void Camera::getDropPolicy(DropPolicy& policy)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setTrigMode() " << DEB_VAR1(mode);
-	DEB_PARAM() << DEB_VAR1(mode);
-	//@BEGIN
+	policy = m_drop_policy;
+	DEB_RETURN() << DEB_VAR1(policy);
+}
 
-	m_trigger_mode = mode;
-	//@END
+//-----------------------------------------------------
+// @brief nb of frames missing in the SDK index sequence or overwritten in the SDK ring during the last acquisition
+//-----------------------------------------------------
+void Camera::getDroppedFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_nb_dropped + m_nb_overwritten;
+	DEB_RETURN() << DEB_VAR1(nb_frames);
+}
+
+//-----------------------------------------------------
+// @brief nb of frames received twice from the SDK during the last acquisition
+//-----------------------------------------------------
+void Camera::getDuplicatedFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_nb_duplicated;
+	DEB_RETURN() << DEB_VAR1(nb_frames);
+}
+
+//-----------------------------------------------------
+// @brief per-stage frame counters of the current acquisition, read without lock
+// the counters only increase during an acquisition, the downstream ones are read first so that
+// nb_delivered <= nb_queued, the sequence number detects a reset by startAcq during the read
+//-----------------------------------------------------
+void Camera::getFrameCounters(int& nb_received, int& nb_queued, int& nb_delivered, int& nb_dropped, int& nb_duplicated)
+{
+	DEB_MEMBER_FUNCT();
+	unsigned int seq0, seq1;
+	do
+	{
+		seq0 = m_counters_seq.load(std::memory_order_acquire);
+		nb_delivered = m_acq_frame_nb.load(std::memory_order_acquire);
+		nb_queued = m_grab_frame_nb.load(std::memory_order_acquire);
+		nb_dropped = m_nb_dropped.load(std::memory_order_acquire) + m_nb_overwritten.load(std::memory_order_acquire);
+		nb_duplicated = m_nb_duplicated.load(std::memory_order_acquire);
+		nb_received = m_nb_received.load(std::memory_order_acquire);
+		seq1 = m_counters_seq.load(std::memory_order_acquire);
+	} while((seq0 & 1) || seq0 != seq1);
+	DEB_RETURN() << DEB_VAR5(nb_received, nb_queued, nb_delivered, nb_dropped, nb_duplicated);
+}
 
+//-----------------------------------------------------
+// @brief count, mean, median, 99th percentile and max time (us) spent in a stage since the last reset
+//-----------------------------------------------------
+void Camera::getLatencyStats(LatencyStage stage, int& count, double& mean_us, double& p50_us, double& p99_us, double& max_us)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(stage);
+	if(stage < 0 || stage >= NbLatencyStages)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Invalid latency stage " << DEB_VAR1(stage);
+	}
+	m_latency[stage].getStats(count, mean_us, p50_us, p99_us, max_us);
+	DEB_RETURN() << DEB_VAR5(count, mean_us, p50_us, p99_us, max_us);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getTrigMode(TrigMode& mode)
+void Camera::resetLatencyStats()
 {
 	DEB_MEMBER_FUNCT();
-	mode = m_trigger_mode;
-	DEB_RETURN() << DEB_VAR1(mode);
+	for(int stage = 0; stage < NbLatencyStages; stage++)
+		m_latency[stage].reset();
+}
+
+//-----------------------------------------------------
+// @brief record the begin/end events of the acquisition threads, enabling clears the previous ones
+// the tracing is process wide, the events of the other cameras are cleared too
+//-----------------------------------------------------
+void Camera::setTracing(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	Trace::setEnabled(enable);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getExpTime(double& exp_time)
+void Camera::getTracing(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	double dbVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, &dbVal))
+	enable = Trace::isEnabled();
+	DEB_RETURN() << DEB_VAR1(enable);
+}
+
+//-----------------------------------------------------
+// @brief write the recorded events in the Chrome trace event format (chrome://tracing, ui.perfetto.dev)
+//-----------------------------------------------------
+void Camera::dumpTrace(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(file_name);
+	std::ofstream file(file_name.c_str());
+	if(!file)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_EXPOSURETM from the camera !";
+		THROW_HW_ERROR(Error) << "Unable to open the trace file " << file_name;
+	}
+	Trace::dump(file);
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to write the trace file " << file_name;
 	}
-	m_exp_time = dbVal / 1000;//TUCAM use (ms), but lima use (second) as unit 
-	//@END
-	exp_time = m_exp_time;
-	DEB_RETURN() << DEB_VAR1(exp_time);
 }
 
 //-----------------------------------------------------
-//
+// @brief keep the current settings under this name, in memory and in the SDK profile file
 //-----------------------------------------------------
-void Camera::setExpTime(double exp_time)
+void Camera::saveProfile(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setExpTime() " << DEB_VAR1(exp_time);
-	//@BEGIN
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_time * 1000))//TUCAM use (ms), but lima use (second) as unit 
+	DEB_PARAM() << DEB_VAR1(name);
+	waitInitDone();
+	if(name.empty() || name.find(',') != std::string::npos)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_EXPOSURETM to the camera !";
+		THROW_HW_ERROR(InvalidValue) << "Invalid profile name '" << name << "'";
+	}
+	Profile profile;
+	snapshotProfile(profile);
+	m_profiles[name] = profile;
+	//the SDK file keeps all the camera settings, for the next processes too
+	if(TUCAMRET_SUCCESS != TUCAM_File_SaveProfiles(m_opCam.hIdxTUCam, (PCHAR) name.c_str()))
+	{
+		DEB_WARNING() << "Unable to save the SDK profile " << name << ", it is only kept in memory";
 	}
-	//@END
-	m_exp_time = exp_time;
 }
 
-
 //-----------------------------------------------------
+// @brief write the settings of the profile which differ from the current ones
 //
+// A profile not saved by this process is loaded from the SDK profile file, all at once.
 //-----------------------------------------------------
-void Camera::setLatTime(double lat_time)
+void Camera::applyProfile(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setLatTime() " << DEB_VAR1(lat_time);
-	m_lat_time = lat_time;
+	DEB_PARAM() << DEB_VAR1(name);
+	waitInitDone();
+	TraceScope trace("applyProfile");
+	if(m_thread_running)
+	{
+		THROW_HW_ERROR(Error) << "Unable to switch the profile during an acquisition !";
+	}
+	Timestamp t0 = Timestamp::now();
+	int nb_writes = 0;
+
+	std::map<std::string, Profile>::iterator it = m_profiles.find(name);
+	if(it == m_profiles.end())
+	{
+		loadSdkProfile(name);
+		nb_writes = 1;
+		snapshotProfile(m_profiles[name]);
+	}
+	else
+	{
+		const Profile& target = it->second;
+		Profile current;
+		snapshotProfile(current);
+		if(target.global_gain != current.global_gain)
+		{
+			setGlobalGain(target.global_gain);
+			nb_writes++;
+		}
+		//the exposure read back is rounded by the camera, as the saved one
+		if(fabs(target.exp_time - current.exp_time) > 1e-7)
+		{
+			setExpTime(target.exp_time);
+			nb_writes++;
+		}
+		//the roi is in binned pixels, the binning is written first
+		bool bin_changed = (target.bin != current.bin);
+		if(bin_changed)
+		{
+			setBin(target.bin);
+			nb_writes++;
+		}
+		if(bin_changed || !(target.roi == current.roi))
+		{
+			setRoi(target.roi);
+			nb_writes++;
+		}
+		//trigger mode and edge are written by prepareAcq
+		setTrigMode(target.lima_trigger_mode);
+		m_tucam_trigger_mode = target.trigger_mode;
+		m_tucam_trigger_edge_mode = target.trigger_edge;
+		for(int port = 0; port < NB_OUTPUT_PORTS; port++)
+		{
+			const OutputSignal& o = target.outputs[port];
+			const OutputSignal& c = current.outputs[port];
+			if(o.signal != c.signal || o.edge != c.edge || o.delay != c.delay || o.width != c.width)
+			{
+				setOutputSignal(port, o.signal, o.edge, o.delay, o.width);
+				nb_writes++;
+			}
+		}
+	}
+
+	m_profile_name = name;
+	m_profile_switch_ms = (Timestamp::now() - t0) * 1000;
+	m_profile_nb_writes = nb_writes;
+	DEB_TRACE() << "Profile " << name << " applied in " << m_profile_switch_ms << " (ms), " << nb_writes << " setting(s) written";
 }
 
 //-----------------------------------------------------
-//
+// @brief forget the profile, the SDK profile file is left
 //-----------------------------------------------------
-void Camera::getLatTime(double& lat_time)
+void Camera::deleteProfile(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	//@END
-	m_lat_time = lat_time;
-	DEB_RETURN() << DEB_VAR1(lat_time);
+	DEB_PARAM() << DEB_VAR1(name);
+	if(!m_profiles.erase(name))
+	{
+		THROW_HW_ERROR(InvalidValue) << "No profile " << name;
+	}
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getExposureTimeRange(double& min_expo, double& max_expo) const
+void Camera::getProfileNames(std::string& names)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	min_expo = 0.;
-	max_expo = 10;//10s
-	//@END
-	DEB_RETURN() << DEB_VAR2(min_expo, max_expo);
+	names.clear();
+	for(std::map<std::string, Profile>::const_iterator it = m_profiles.begin(); it != m_profiles.end(); ++it)
+	{
+		if(!names.empty())
+			names += ',';
+		names += it->first;
+	}
+	DEB_RETURN() << DEB_VAR1(names);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getLatTimeRange(double& min_lat, double& max_lat) const
+void Camera::getProfile(const std::string& name, Profile& profile)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	// --- no info on min latency
-	min_lat = 0.;
-	// --- do not know how to get the max_lat, fix it as the max exposure time
-	max_lat = 10;//10s
-	//@END
-	DEB_RETURN() << DEB_VAR2(min_lat, max_lat);
+	std::map<std::string, Profile>::const_iterator it = m_profiles.find(name);
+	if(it == m_profiles.end())
+	{
+		THROW_HW_ERROR(InvalidValue) << "No profile " << name;
+	}
+	profile = it->second;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::setNbFrames(int nb_frames)
+void Camera::getProfileSwitch(std::string& name, double& switch_ms, int& nb_writes)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setNbFrames() " << DEB_VAR1(nb_frames);
-	//@BEGIN
-	if(nb_frames < 0)
+	name = m_profile_name;
+	switch_ms = m_profile_switch_ms;
+	nb_writes = m_profile_nb_writes;
+}
+
+//-----------------------------------------------------
+// @brief current settings, only the output signals not yet known are read from the camera
+//-----------------------------------------------------
+void Camera::snapshotProfile(Profile& profile)
+{
+	DEB_MEMBER_FUNCT();
+	getExpTime(profile.exp_time);
+	getGlobalGain(profile.global_gain);
+	profile.roi = m_roi;
+	getBin(profile.bin);
+	profile.lima_trigger_mode = m_trigger_mode;
+	profile.trigger_mode = m_tucam_trigger_mode;
+	profile.trigger_edge = m_tucam_trigger_edge_mode;
+	for(int port = 0; port < NB_OUTPUT_PORTS; port++)
 	{
-		THROW_HW_ERROR(Error) << "Number of frames to acquire has not been set";
+		OutputSignal& o = profile.outputs[port];
+		getOutputSignal(port, o.signal, o.edge, o.delay, o.width);
 	}
-	if(nb_frames > 1)
+}
+
+//-----------------------------------------------------
+// @brief TUCAM_File_LoadProfiles, then the driver state is read back from the camera
+//-----------------------------------------------------
+void Camera::loadSdkProfile(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	//the SDK loads a profile only when the capture is stopped (keep armed)
+	stopCapture();
+	if(TUCAMRET_SUCCESS != TUCAM_File_LoadProfiles(m_opCam.hIdxTUCam, (PCHAR) name.c_str()))
 	{
-		//THROW_HW_ERROR(Error) << "Unable to acquire more than 1 frame ! ";	//T@D@ allowed only for test 
+		THROW_HW_ERROR(InvalidValue) << "No profile " << name;
+	}
+	//any setting may have changed, the geometry too
+	m_prop_cache.invalidateAll();
+	std::fill(m_outputs_valid, m_outputs_valid + NB_OUTPUT_PORTS, false);
+	releaseSdkBuffer();
+	readBackImageType();
+	readBackBin();
+	m_roi_attr_valid = false;
+	getRoi(m_roi);
+
+	TUCAM_TRIGGER_ATTR tgrAttr;
+	if(TUCAMRET_SUCCESS == TUCAM_Cap_GetTrigger(m_opCam.hIdxTUCam, &tgrAttr))
+	{
+		switch(tgrAttr.nTgrMode)
+		{
+		case TUCCM_TRIGGER_STANDARD:
+		case TUCCM_TRIGGER_SYNCHRONOUS:
+		case TUCCM_TRIGGER_GLOBAL:
+			m_tucam_trigger_mode = (TucamTriggerMode) tgrAttr.nTgrMode;
+			m_tucam_trigger_edge_mode = (TucamTriggerEdge) tgrAttr.nEdgeMode;
+			//the exposure mode tells the gate from the edge triggers, single or multi is not in the SDK profile
+			if(tgrAttr.nExpMode == TUCTE_WIDTH)
+				m_trigger_mode = ExtGate;
+			else if(m_trigger_mode != ExtTrigSingle)
+				m_trigger_mode = ExtTrigMult;
+			break;
+		default:
+			//software trigger : internal trigger
+			m_trigger_mode = IntTrig;
+			break;
+		}
 	}
-	//@END
-	m_nb_frames = nb_frames;
 }
 
 //-----------------------------------------------------
-//
+// @brief depth from TUIDC_BITOFDEPTH and TUIDC_IMGMODESELECT, as written by setImageType
 //-----------------------------------------------------
-void Camera::getNbFrames(int& nb_frames)
+void Camera::readBackImageType()
 {
 	DEB_MEMBER_FUNCT();
-	DEB_RETURN() << DEB_VAR1(m_nb_frames);
-	//@BEGIN
-	//@END
-	nb_frames = m_nb_frames;
+	int bits = 16;
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, &bits))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDC_BITOFDEPTH from the camera !";
+	}
+	int img_mode = m_img_mode_16;
+	if(m_img_mode_12 >= 0)
+		TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_IMGMODESELECT, &img_mode);
+	if(bits == 8)
+		m_depth = 8;
+	else
+		m_depth = (m_img_mode_12 >= 0 && img_mode == m_img_mode_12) ? 12 : 16;
+	DEB_TRACE() << DEB_VAR1(m_depth);
 }
 
 //-----------------------------------------------------
-//
+// @brief hardware binning from TUIDC_BINNING_SUM/AVG, the software binning is kept if the camera does not bin
 //-----------------------------------------------------
-int Camera::getNbHwAcquiredFrames()
+void Camera::readBackBin()
 {
 	DEB_MEMBER_FUNCT();
-	return m_acq_frame_nb;
+	const int capas[2] = {TUIDC_BINNING_SUM, TUIDC_BINNING_AVG};
+	Bin hw_bin(1, 1);
+	for(int mode = BinSum; mode <= BinAvg && hw_bin == Bin(1, 1); mode++)
+	{
+		int value;
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, capas[mode], &value))
+			continue;
+		std::map<std::pair<int, int>, int>::const_iterator it;
+		for(it = m_hw_bin_values[mode].begin(); it != m_hw_bin_values[mode].end(); ++it)
+		{
+			if(it->second == value && it->first != std::make_pair(1, 1))
+			{
+				hw_bin = Bin(it->first.first, it->first.second);
+				m_bin_mode = (BinMode) mode;
+				break;
+			}
+		}
+	}
+	m_hw_bin = hw_bin;
+	if(m_hw_bin != Bin(1, 1))
+		m_sw_bin = Bin(1, 1);
+	m_bin = (m_hw_bin != Bin(1, 1)) ? m_hw_bin : m_sw_bin;
+	DEB_TRACE() << DEB_VAR3(m_bin, m_hw_bin, m_sw_bin);
 }
 
 //-----------------------------------------------------
-// @brief range the binning to the maximum allowed
+// @brief temperature and fan sampling period (s) of the telemetry thread, 0 : no sampling
 //-----------------------------------------------------
-void Camera::checkBin(Bin &hw_bin)
+void Camera::setTelemetryPeriod(double period)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : check available values of binning H/V
-	int x = hw_bin.getX();
-	int y = hw_bin.getY();
-	if(x != 1 || y != 1)
+	DEB_PARAM() << DEB_VAR1(period);
+	if(period < 0)
 	{
-		DEB_ERROR() << "Binning values not supported";
-		THROW_HW_ERROR(Error) << "Binning values not supported = " << DEB_VAR1(hw_bin);
+		THROW_HW_ERROR(InvalidValue) << "Telemetry period must be >= 0";
 	}
-	//@END
-
-	hw_bin = Bin(x, y);
-	DEB_RETURN() << DEB_VAR1(hw_bin);
+	AutoMutex aLock(m_telemetry_cond.mutex());
+	m_telemetry_period = period;
+	m_telemetry_cond.broadcast();
 }
+
 //-----------------------------------------------------
-// @brief set the new binning mode
+//
 //-----------------------------------------------------
-void Camera::setBin(const Bin &set_bin)
+void Camera::getTelemetryPeriod(double& period)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : set binning H/V to the Driver/API
-	//...
-	//@END
-	m_bin = set_bin;
-
-	DEB_RETURN() << DEB_VAR1(set_bin);
+	AutoMutex aLock(m_telemetry_cond.mutex());
+	period = m_telemetry_period;
+	DEB_RETURN() << DEB_VAR1(period);
 }
 
 //-----------------------------------------------------
-// @brief return the current binning mode
+// @brief last sample of the telemetry thread, timestamp is 0 if there is none
 //-----------------------------------------------------
-void Camera::getBin(Bin &hw_bin)
+void Camera::getTelemetry(double& timestamp, double& temperature, double& temperature_target, int& fan_speed)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : get binning from Driver/API
-	int bin_x = 1;
-	int bin_y = 1;
-	//@END
-	Bin tmp_bin(bin_x, bin_y);
-
-	hw_bin = tmp_bin;
-	m_bin = tmp_bin;
-
-	DEB_RETURN() << DEB_VAR1(hw_bin);
+	AutoMutex aLock(m_telemetry_cond.mutex());
+	TelemetrySample sample = {0., 0., m_temperature_target, 0};
+	if(m_telemetry_nb > 0)
+		sample = m_telemetry_history[(m_telemetry_nb - 1) % TELEMETRY_HISTORY_SIZE];
+	timestamp = sample.timestamp;
+	temperature = sample.temperature;
+	temperature_target = sample.temperature_target;
+	fan_speed = sample.fan_speed;
+	DEB_RETURN() << DEB_VAR4(timestamp, temperature, temperature_target, fan_speed);
 }
 
 //-----------------------------------------------------
-//! Camera::checkRoi()
+// @brief last TELEMETRY_HISTORY_SIZE samples, oldest first
 //-----------------------------------------------------
-void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
+void Camera::getTelemetryHistory(std::vector<double>& timestamps, std::vector<double>& temperatures, std::vector<int>& fan_speeds)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "checkRoi";
-	DEB_PARAM() << DEB_VAR1(set_roi);
-	//@BEGIN : check available values of Roi
-	if(set_roi.isActive())
-	{
-	        setRoi(set_roi);
-		getRoi(hw_roi);
-		//hw roi X is multple of 4 and camera return the lower value
-		if (hw_roi.getTopLeft().x < set_roi.getTopLeft().x)
-		  {
-		    Size s1 = hw_roi.getSize();
-		    //hw roi width is multiple of 8, so increase it to let lima doing subroi
-		    Size* s2 = new Size(s1.getWidth()+8,s1.getHeight());
-		    hw_roi.setSize(*s2);
-		  }
-		if(hw_roi.getSize().getWidth() < set_roi.getSize().getWidth())
-		  {
-		    Size s1 = hw_roi.getSize();
-		    //hw roi width is multiple of 8, so increase it to let lima doing subroi
-		    Size* s2 = new Size(s1.getWidth()+8,s1.getHeight());
-		    hw_roi.setSize(*s2);	    
-		  }
-	}
-	else
+	AutoMutex aLock(m_telemetry_cond.mutex());
+	int nb = std::min(m_telemetry_nb, TELEMETRY_HISTORY_SIZE);
+	timestamps.resize(nb);
+	temperatures.resize(nb);
+	fan_speeds.resize(nb);
+	for(int i = 0; i < nb; i++)
 	{
-		hw_roi = set_roi;
+		const TelemetrySample& sample = m_telemetry_history[(m_telemetry_nb - nb + i) % TELEMETRY_HISTORY_SIZE];
+		timestamps[i] = sample.timestamp;
+		temperatures[i] = sample.temperature;
+		fan_speeds[i] = sample.fan_speed;
 	}
-	//@END
-
-
-	DEB_RETURN() << DEB_VAR1(hw_roi);
 }
 
-//---------------------------------------------------------------------------------------
-//! Camera::getRoi()
-//---------------------------------------------------------------------------------------
-void Camera::getRoi(Roi& hw_roi)
+//-----------------------------------------------------
+// @brief read the temperature and the fan, called by the telemetry thread without the lock
+//-----------------------------------------------------
+void Camera::sampleTelemetry()
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : get Roi from the Driver/API
-	TUCAM_ROI_ATTR roiAttr;
-	if(TUCAMRET_SUCCESS != TUCAM_Cap_GetROI(m_opCam.hIdxTUCam, &roiAttr))
+	TelemetrySample sample;
+	int nVal = 0;
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &sample.temperature) ||
+	   TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
 	{
-		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
+		DEB_WARNING() << "Unable to Read the temperature and the fan speed from the camera !";
+		return;
 	}
-	hw_roi = Roi(roiAttr.nHOffset,
-				roiAttr.nVOffset,
-				roiAttr.nWidth,
-				roiAttr.nHeight);
-	//@END
-
-	DEB_RETURN() << DEB_VAR1(hw_roi);
+	sample.timestamp = Timestamp::now();
+	sample.temperature_target = m_temperature_target;
+	sample.fan_speed = nVal;
+	//the getters read the cache without accessing the camera
+	m_prop_cache.set(PropTemperature, sample.temperature);
+	m_prop_cache.set(PropFanSpeed, nVal);
+
+	AutoMutex aLock(m_telemetry_cond.mutex());
+	m_telemetry_history[m_telemetry_nb % TELEMETRY_HISTORY_SIZE] = sample;
+	m_telemetry_nb++;
 }
 
-//---------------------------------------------------------------------------------------
-//! Camera::setRoi()
-//---------------------------------------------------------------------------------------
-void Camera::setRoi(const Roi& set_roi)
+//-----------------------------------------------------
+// @brief the temperature is read from the camera at most once per period (s), 0 : at each read
+//-----------------------------------------------------
+void Camera::setTemperatureRefresh(double period)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setRoi";
-	DEB_PARAM() << DEB_VAR1(set_roi);
-	//@BEGIN : set Roi from the Driver/API	
-	if(!set_roi.isActive())
-	{
-		DEB_TRACE() << "Roi is not Enabled : so set full frame";
-
-		//set Roi to Driver/API
-		Size size;
-		getDetectorImageSize(size);
-		TUCAM_ROI_ATTR roiAttr;
-		roiAttr.bEnable = TRUE;
-		roiAttr.nHOffset = 0;
-		roiAttr.nVOffset = 0;
-		roiAttr.nWidth = size.getWidth();
-		roiAttr.nHeight = size.getHeight();
-
-		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
-		}
-
-	}
-	else
+	DEB_PARAM() << DEB_VAR1(period);
+	if(period < 0)
 	{
-		DEB_TRACE() << "Roi is Enabled";
-		//set Roi to Driver/API
-		TUCAM_ROI_ATTR roiAttr;
-		roiAttr.bEnable = TRUE;
-		roiAttr.nHOffset = set_roi.getTopLeft().x;
-		roiAttr.nVOffset = set_roi.getTopLeft().y;
-		roiAttr.nWidth = set_roi.getSize().getWidth();
-		roiAttr.nHeight = set_roi.getSize().getHeight();
-
-		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
-		}
+		THROW_HW_ERROR(InvalidValue) << "Temperature refresh period must be >= 0";
 	}
-	//@END	
+	m_prop_cache.setMaxAge(PropTemperature, period);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-bool Camera::isAcqRunning() const
+void Camera::getTemperatureRefresh(double& period)
 {
 	DEB_MEMBER_FUNCT();
-	//	AutoMutex aLock(m_cond.mutex());
-	DEB_TRACE() << "isAcqRunning - " << DEB_VAR1(m_thread_running) << "---------------------------";
-	return m_thread_running;
+	m_prop_cache.getMaxAge(PropTemperature, period);
+	DEB_RETURN() << DEB_VAR1(period);
 }
 
-///////////////////////////////////////////////////////
-// Dhyana specific stuff now
-///////////////////////////////////////////////////////
-
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::setTemperatureTarget(double temp)
+// @brief nb of property reads answered from the cache
+//-----------------------------------------------------
+void Camera::getPropertyCacheHits(int& nb_hits)
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_PROP_ATTR attrProp;
-	attrProp.nIdxChn = 0;// Current channel (camera monochrome = 0) . VERY IMPORTANT, doesn't work otherwise !!!!!
-	attrProp.idProp = TUIDP_TEMPERATURE;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetAttr(m_opCam.hIdxTUCam, &attrProp))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE range from the camera !";
-	}
-	DEB_TRACE() << "Temperature range [" << (int) attrProp.dbValMin << " , " << (int) attrProp.dbValMax << "]";
-
-	int temp_middle = (int) attrProp.dbValMax / 2;
-	if(((int) temp + temp_middle)<((int) attrProp.dbValMin) || ((int) temp + temp_middle)>((int) attrProp.dbValMax))
-	{
-		THROW_HW_ERROR(Error) << "Unable to set the Temperature Target !\n"
-		 << "It is out of range : "
-		 << "["
-		 << (int) attrProp.dbValMin - temp_middle
-		 << ","
-		 << (int) attrProp.dbValMax - temp_middle
-		 << "]";
-	}
-
-	int nVal = (int) temp + temp_middle;//temperatureTarget is a delta according to the middle temperature !!
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, nVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_TEMPERATURE to the camera !";
-	}
-	m_temperature_target = (double) temp;
+	m_prop_cache.getHits(nb_hits);
+	DEB_RETURN() << DEB_VAR1(nb_hits);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getTemperatureTarget(double& temp)
+// @brief nb of property reads sent to the camera
+//-----------------------------------------------------
+void Camera::getPropertyCacheMisses(int& nb_misses)
 {
 	DEB_MEMBER_FUNCT();
-
-	temp = m_temperature_target;
+	m_prop_cache.getMisses(nb_misses);
+	DEB_RETURN() << DEB_VAR1(nb_misses);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getTemperature(double& temp)
+// @brief min, max, mean, saturated pixels and histogram of each frame, computed during the copy
+//-----------------------------------------------------
+void Camera::setFrameStatistics(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-
-	double dbVal = 0.0f;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE from the camera !";
-	}
-	temp = dbVal;
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_frame_stats = enable;
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::setFanSpeed(unsigned speed)
+//-----------------------------------------------------
+void Camera::getFrameStatistics(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-
-	int nVal = (int) speed;
-
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, nVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_FAN_GEAR to the camera !";
-	}
+	enable = m_frame_stats;
+	DEB_RETURN() << DEB_VAR1(enable);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getFanSpeed(unsigned& speed)
+// @brief statistics of frame_nb (-1 : last frame), false if the frame is not in the last FRAME_STATS_RING_SIZE
+//-----------------------------------------------------
+bool Camera::getFrameStats(int frame_nb, FrameStats& stats)
 {
 	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(frame_nb);
+	bool ok = (frame_nb < 0) ? m_frame_stats_ring.getLast(stats) : m_frame_stats_ring.get(frame_nb, stats);
+	if (!ok)
+		stats.frame_nb = -1;
+	DEB_RETURN() << DEB_VAR1(ok);
+	return ok;
+}
 
-	int nVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDC_FAN_GEAR from the camera !";
-	}
-	speed = (unsigned) nVal;
+//-----------------------------------------------------
+// @brief histogram of frame_nb (-1 : last frame), FRAME_STATS_HIST_BINS bins over the pixel range, empty if not available
+//-----------------------------------------------------
+void Camera::getFrameHistogram(int frame_nb, std::vector<int>& histogram)
+{
+	DEB_MEMBER_FUNCT();
+	FrameStats stats;
+	histogram.clear();
+	if (getFrameStats(frame_nb, stats))
+		histogram.assign(stats.histogram, stats.histogram + FRAME_STATS_HIST_BINS);
 }
 
 //-----------------------------------------------------
+// @brief exposures (s) of the successive frames in internal trigger, the sequence is repeated
 //
-//-----------------------------------------------------  
-void Camera::setGlobalGain(TucamGain gain)
+// The exposure is written by the trigger thread after the readout of a frame, before the
+// next software trigger, the capture is not stopped. An empty sequence uses the exposure time.
+//-----------------------------------------------------
+void Camera::setExposureSequence(const std::vector<double>& exp_times)
 {
 	DEB_MEMBER_FUNCT();
-
-	double dbVal = (double) gain;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, dbVal))
+	DEB_PARAM() << DEB_VAR1(exp_times.size());
+	waitInitDone();
+	if(m_thread_running)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_GLOBALGAIN to the camera !";
+		THROW_HW_ERROR(Error) << "Unable to change the exposure sequence during an acquisition !";
+	}
+	double min_expo, max_expo;
+	getExposureTimeRange(min_expo, max_expo);
+	for(size_t i = 0; i < exp_times.size(); i++)
+	{
+		if(exp_times[i] <= min_expo || exp_times[i] > max_expo)
+		{
+			THROW_HW_ERROR(InvalidValue) << "Exposure " << exp_times[i] << " (s) of the sequence out of range ]"
+						     << min_expo << ", " << max_expo << "]";
+		}
 	}
+	m_exp_sequence = exp_times;
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::getGlobalGain(TucamGain& gain)
+//-----------------------------------------------------
+void Camera::getExposureSequence(std::vector<double>& exp_times)
 {
 	DEB_MEMBER_FUNCT();
-
-	double dbVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, &dbVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_GLOBALGAIN from the camera !";
-	}
-	gain = (TucamGain)dbVal;
+	waitInitDone();
+	exp_times = m_exp_sequence;
+	DEB_RETURN() << DEB_VAR1(exp_times.size());
 }
 
 //-----------------------------------------------------
-//
+// @brief exposure (s) of frame_nb (-1 : last frame), false if the frame is not in the last FRAME_STATS_RING_SIZE
 //-----------------------------------------------------
-void Camera::getTucamVersion(std::string& version)
+bool Camera::getFrameExposure(int frame_nb, double& exp_time)
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_VERSION_API;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	DEB_PARAM() << DEB_VAR1(frame_nb);
+	if(frame_nb < 0)
+		frame_nb = m_frame_exp_last.load();
+	bool ok = false;
+	exp_time = 0.;
+	if(frame_nb >= 0)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_API from the camera !";
+		//the slot is read again if the delivery thread wrote it meanwhile
+		int slot = frame_nb & (FRAME_STATS_RING_SIZE - 1);
+		int nb = m_frame_exp_nb[slot].load();
+		exp_time = m_frame_exp[slot].load();
+		ok = (nb == frame_nb && m_frame_exp_nb[slot].load() == frame_nb);
 	}
-	version = valInfo.pText;
+	if(!ok)
+		exp_time = 0.;
+	DEB_RETURN() << DEB_VAR2(ok, exp_time);
+	return ok;
+}
+
+//-----------------------------------------------------
+// @brief exposure of the frame triggered at position, m_exp_time if there is no sequence
+//-----------------------------------------------------
+double Camera::sequenceExposure(int position) const
+{
+	if(!m_exp_sequence_active || position < 0)
+		return m_exp_time;
+	return m_exp_sequence[position % m_exp_sequence.size()];
 }
 
 //-----------------------------------------------------
 //
-//-----------------------------------------------------  
-void Camera::getFirmwareVersion(std::string& version)
+//-----------------------------------------------------
+void Camera::clearFrameExposures()
 {
-	DEB_MEMBER_FUNCT();
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_VERSION_FRMW;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	for(int i = 0; i < FRAME_STATS_RING_SIZE; i++)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_FRMW from the camera !";
+		m_frame_exp_nb[i] = -1;
+		m_frame_exp[i] = 0.;
 	}
-	version = valInfo.nValue;
-	version = valInfo.pText;
+	m_frame_exp_last = -1;
 }
 
 //-----------------------------------------------------
-//
+// @brief called by the delivery thread only, readers never lock
 //-----------------------------------------------------
-void Camera::setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge, int delay, int width)
+void Camera::recordFrameExposure(int frame_nb, double exp_time)
 {
-  DEB_MEMBER_FUNCT();
-  TUCAM_TRGOUT_ATTR tgroutAttr;
-
-  if (port <0 || port >2)
-    {
-      THROW_HW_ERROR(Error) << "Invalid output port number range is [0-2]";
-
-    }
-  tgroutAttr.nTgrOutPort = port;
-  tgroutAttr.nTgrOutMode = (int)signal;
-  tgroutAttr.nEdgeMode = (int)edge;
-  tgroutAttr.nDelayTm = delay;
-  tgroutAttr.nWidth = width;
-    
-  if(TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut (m_opCam.hIdxTUCam, tgroutAttr))
-    {
-      THROW_HW_ERROR(Error) << "Unable to set Output signal port "<< port;
-    }
-  
+	int slot = frame_nb & (FRAME_STATS_RING_SIZE - 1);
+	m_frame_exp_nb[slot] = -1;
+	m_frame_exp[slot] = exp_time;
+	m_frame_exp_nb[slot] = frame_nb;
+	m_frame_exp_last = frame_nb;
 }
 
-void Camera::getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width)
+//-----------------------------------------------------
+// @brief delay (us) between the internal trigger deadlines and the triggers really sent
+//-----------------------------------------------------
+void Camera::getTriggerJitter(double& mean_us, double& std_us, double& max_us)
 {
-  DEB_MEMBER_FUNCT();
-  TUCAM_TRGOUT_ATTR tgroutAttr;
+	DEB_MEMBER_FUNCT();
+	m_internal_trigger_timer->getJitter(mean_us, std_us, max_us);
+	DEB_RETURN() << DEB_VAR3(mean_us, std_us, max_us);
+}
 
-  tgroutAttr.nTgrOutPort = port;
+//-----------------------------------------------------
+// @brief set the number of frames the SDK can hold before the acquisition thread reads them
+//-----------------------------------------------------
+void Camera::setNbSdkBuffers(int nb_buffers)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_buffers);
+	if (nb_buffers < 1)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Number of SDK buffers must be at least 1";
+	}
+	if (isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Cannot change the number of SDK buffers while acquisition is running";
+	}
+	//the SDK buffer is allocated again with the new depth at next prepareAcq
+	m_nb_sdk_buffers = nb_buffers;
+}
 
-  if(TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut (m_opCam.hIdxTUCam, &tgroutAttr))
-    {
-      THROW_HW_ERROR(Error) << "Unable to get Output signal port "<< port;
-    }  
-  signal = (TucamSignal) tgroutAttr.nTgrOutMode;
-  edge = (TucamSignalEdge)tgroutAttr.nEdgeMode;
-  delay = tgroutAttr.nDelayTm;
-  width =tgroutAttr.nWidth;
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getNbSdkBuffers(int& nb_buffers)
+{
+	DEB_MEMBER_FUNCT();
+	nb_buffers = m_nb_sdk_buffers;
+	DEB_RETURN() << DEB_VAR1(nb_buffers);
 }
     
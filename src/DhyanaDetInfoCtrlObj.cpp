@@ -66,7 +66,8 @@ void DetInfoCtrlObj::getDetectorImageSize(Size& image_size)
 void DetInfoCtrlObj::getDefImageType(ImageType& image_type)
 {
 	DEB_MEMBER_FUNCT();
-	m_cam.getImageType(image_type);
+	//Bpp8 and Bpp12 are faster readout modes, selected by setCurrImageType
+	image_type = Bpp16;
 }
 
 //-----------------------------------------------------
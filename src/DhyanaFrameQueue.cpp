@@ -0,0 +1,73 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "lima/Exceptions.h"
+#include "DhyanaFrameQueue.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+FrameQueue::FrameQueue(int capacity) :
+m_mask(0),
+m_capacity(0),
+m_head(0),
+m_tail(0),
+m_high_water(0)
+{
+	DEB_CONSTRUCTOR();
+	resize(capacity);
+}
+
+//-----------------------------------------------------
+// @brief set the max nb of frames in the queue, the queue is emptied
+//-----------------------------------------------------
+void FrameQueue::resize(int capacity)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(capacity);
+	if (capacity < 1)
+	{
+		THROW_HW_ERROR(InvalidValue) << "Frame queue capacity must be at least 1";
+	}
+
+	unsigned int nb_slots = 1;
+	while (nb_slots < (unsigned int) capacity)
+		nb_slots <<= 1;
+	m_slots.resize(nb_slots);
+	m_mask = nb_slots - 1;
+	m_capacity = capacity;
+	clear();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameQueue::clear()
+{
+	DEB_MEMBER_FUNCT();
+	m_head.store(0);
+	m_tail.store(0);
+	m_high_water.store(0);
+}
@@ -0,0 +1,311 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <string.h>
+#include <algorithm>
+#include "DhyanaFrameStats.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DHYANA_STATS_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DHYANA_STATS_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+namespace
+{
+
+//partial results, merged at the end of the frame
+struct StatsAcc
+{
+	unsigned int		min;
+	unsigned int		max;
+	unsigned long long	sum;
+	unsigned long long	nb_saturated;
+	//4 histograms, consecutive pixels often fall in the same bin
+	unsigned int		hist[4][FRAME_STATS_HIST_BINS];
+};
+
+typedef void (*Stats16Func)(const unsigned short* src, unsigned short* dst, int n,
+			    unsigned int saturation, int shift, StatsAcc& acc);
+
+//-----------------------------------------------------
+// scalar, also used for the end of the SIMD loops
+//-----------------------------------------------------
+template <class T>
+void statsScalar(const T* src, T* dst, int n, unsigned int saturation, int shift, StatsAcc& acc)
+{
+	unsigned int vmin = acc.min, vmax = acc.max;
+	unsigned long long sum = 0, nb_sat = 0;
+	for (int i = 0; i < n; i++)
+	{
+		unsigned int v = src[i];
+		if (dst)
+			dst[i] = src[i];
+		vmin = std::min(vmin, v);
+		vmax = std::max(vmax, v);
+		sum += v;
+		nb_sat += (v >= saturation);
+		acc.hist[i & 3][std::min(v >> shift, (unsigned int) FRAME_STATS_HIST_BINS - 1)]++;
+	}
+	acc.min = vmin;
+	acc.max = vmax;
+	acc.sum += sum;
+	acc.nb_saturated += nb_sat;
+}
+
+void stats16Scalar(const unsigned short* src, unsigned short* dst, int n,
+		   unsigned int saturation, int shift, StatsAcc& acc)
+{
+	statsScalar(src, dst, n, saturation, shift, acc);
+}
+
+//histogram of a block already reduced by SIMD, pixels are 16 bits
+inline void histBlock(const unsigned short* src, int n, int shift, StatsAcc& acc)
+{
+	for (int i = 0; i < n; i++)
+		acc.hist[i & 3][std::min((unsigned int) src[i] >> shift, (unsigned int) FRAME_STATS_HIST_BINS - 1)]++;
+}
+
+#ifdef DHYANA_STATS_AVX2
+//-----------------------------------------------------
+// AVX2, selected at run time
+//-----------------------------------------------------
+__attribute__((target("avx2,popcnt")))
+void stats16Avx2(const unsigned short* src, unsigned short* dst, int n,
+		 unsigned int saturation, int shift, StatsAcc& acc)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i low_bytes = _mm256_set1_epi16(0x00ff);
+	const __m256i sat = _mm256_set1_epi16((short) saturation);
+	__m256i vmin = _mm256_set1_epi16((short) 0xffff);
+	__m256i vmax = zero;
+	//sad_epu8 sums 8 bytes in 64 bits : low and high bytes of the pixels are summed separately
+	__m256i sum_lo = zero, sum_hi = zero;
+	unsigned long long nb_sat = 0;
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*) (src + i));
+		if (dst)
+			_mm256_storeu_si256((__m256i*) (dst + i), v);
+		vmin = _mm256_min_epu16(vmin, v);
+		vmax = _mm256_max_epu16(vmax, v);
+		sum_lo = _mm256_add_epi64(sum_lo, _mm256_sad_epu8(_mm256_and_si256(v, low_bytes), zero));
+		sum_hi = _mm256_add_epi64(sum_hi, _mm256_sad_epu8(_mm256_srli_epi16(v, 8), zero));
+		//v >= sat if max(v, sat) == v, 2 mask bits per pixel
+		__m256i is_sat = _mm256_cmpeq_epi16(_mm256_max_epu16(v, sat), v);
+		nb_sat += __builtin_popcount(_mm256_movemask_epi8(is_sat)) >> 1;
+		histBlock(src + i, 16, shift, acc);
+	}
+
+	unsigned short mins[16], maxs[16];
+	unsigned long long los[4], his[4];
+	_mm256_storeu_si256((__m256i*) mins, vmin);
+	_mm256_storeu_si256((__m256i*) maxs, vmax);
+	_mm256_storeu_si256((__m256i*) los, sum_lo);
+	_mm256_storeu_si256((__m256i*) his, sum_hi);
+	for (int k = 0; k < 16; k++)
+	{
+		acc.min = std::min(acc.min, (unsigned int) mins[k]);
+		acc.max = std::max(acc.max, (unsigned int) maxs[k]);
+	}
+	for (int k = 0; k < 4; k++)
+		acc.sum += los[k] + (his[k] << 8);
+	acc.nb_saturated += nb_sat;
+	statsScalar(src + i, dst ? dst + i : NULL, n - i, saturation, shift, acc);
+}
+#endif
+
+#ifdef DHYANA_STATS_NEON
+//-----------------------------------------------------
+// NEON, always there on aarch64
+//-----------------------------------------------------
+void stats16Neon(const unsigned short* src, unsigned short* dst, int n,
+		 unsigned int saturation, int shift, StatsAcc& acc)
+{
+	const uint16x8_t sat = vdupq_n_u16((unsigned short) saturation);
+	uint16x8_t vmin = vdupq_n_u16(0xffff);
+	uint16x8_t vmax = vdupq_n_u16(0);
+	uint64x2_t sum = vdupq_n_u64(0);
+	uint32x4_t nb_sat = vdupq_n_u32(0);
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		uint16x8_t v = vld1q_u16(src + i);
+		if (dst)
+			vst1q_u16(dst + i, v);
+		vmin = vminq_u16(vmin, v);
+		vmax = vmaxq_u16(vmax, v);
+		sum = vpadalq_u32(sum, vpaddlq_u16(v));
+		nb_sat = vpadalq_u16(nb_sat, vshrq_n_u16(vcgeq_u16(v, sat), 15));
+		histBlock(src + i, 8, shift, acc);
+	}
+
+	unsigned short mins[8], maxs[8];
+	vst1q_u16(mins, vmin);
+	vst1q_u16(maxs, vmax);
+	for (int k = 0; k < 8; k++)
+	{
+		acc.min = std::min(acc.min, (unsigned int) mins[k]);
+		acc.max = std::max(acc.max, (unsigned int) maxs[k]);
+	}
+	acc.sum += vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+	acc.nb_saturated += vaddvq_u32(nb_sat);
+	statsScalar(src + i, dst ? dst + i : NULL, n - i, saturation, shift, acc);
+}
+#endif
+
+Stats16Func selectStats16()
+{
+#ifdef DHYANA_STATS_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return stats16Avx2;
+#endif
+#ifdef DHYANA_STATS_NEON
+	return stats16Neon;
+#else
+	return stats16Scalar;
+#endif
+}
+
+void initAcc(StatsAcc& acc)
+{
+	memset(&acc, 0, sizeof(acc));
+	acc.min = ~0u;
+}
+
+void finishStats(const StatsAcc& acc, int nb_pixels, FrameStats& stats)
+{
+	stats.min = nb_pixels ? acc.min : 0;
+	stats.max = acc.max;
+	stats.mean = nb_pixels ? double(acc.sum) / nb_pixels : 0.;
+	stats.nb_saturated = (int) acc.nb_saturated;
+	for (int b = 0; b < FRAME_STATS_HIST_BINS; b++)
+		stats.histogram[b] = acc.hist[0][b] + acc.hist[1][b] + acc.hist[2][b] + acc.hist[3][b];
+}
+
+} // namespace
+
+//-----------------------------------------------------
+// @brief copy (if dst is not NULL) and statistics of a 16 bits frame in one pass
+//-----------------------------------------------------
+void lima::Dhyana::copyFrameStats16(const unsigned short* src, unsigned short* dst, int nb_pixels,
+				    int depth, FrameStats& stats)
+{
+	static const Stats16Func stats16 = selectStats16();
+	StatsAcc acc;
+	initAcc(acc);
+	stats16(src, dst, nb_pixels, (1u << depth) - 1, depth - 6, acc);
+	finishStats(acc, nb_pixels, stats);
+}
+
+//-----------------------------------------------------
+// @brief copy (if dst is not NULL) and statistics of a 8 bits frame in one pass
+//-----------------------------------------------------
+void lima::Dhyana::copyFrameStats8(const unsigned char* src, unsigned char* dst, int nb_pixels,
+				   FrameStats& stats)
+{
+	StatsAcc acc;
+	initAcc(acc);
+	statsScalar(src, dst, nb_pixels, 255u, 8 - 6, acc);
+	finishStats(acc, nb_pixels, stats);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+FrameStatsRing::FrameStatsRing()
+{
+	for (int i = 0; i < FRAME_STATS_RING_SIZE; i++)
+		m_slots[i].seq.store(0);
+	clear();
+}
+
+//-----------------------------------------------------
+// @brief forget the frames of the previous acquisition
+//-----------------------------------------------------
+void FrameStatsRing::clear()
+{
+	m_last.store(-1, std::memory_order_release);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatsRing::push(const FrameStats& stats)
+{
+	Slot& slot = m_slots[stats.frame_nb & (FRAME_STATS_RING_SIZE - 1)];
+	unsigned int seq = slot.seq.load(std::memory_order_relaxed);
+	slot.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.stats = stats;
+	slot.seq.store(seq + 2, std::memory_order_release);
+	m_last.store(stats.frame_nb, std::memory_order_release);
+}
+
+//-----------------------------------------------------
+// @brief copy a slot, retried while the writer is changing it
+//-----------------------------------------------------
+bool FrameStatsRing::read(unsigned int slot_nb, FrameStats& stats) const
+{
+	const Slot& slot = m_slots[slot_nb & (FRAME_STATS_RING_SIZE - 1)];
+	for (int retry = 0; retry < 100; retry++)
+	{
+		unsigned int seq = slot.seq.load(std::memory_order_acquire);
+		if (seq & 1)
+			continue;
+		stats = slot.stats;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) == seq)
+			return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameStatsRing::get(int frame_nb, FrameStats& stats) const
+{
+	int last = m_last.load(std::memory_order_acquire);
+	if (frame_nb < 0 || frame_nb > last || last - frame_nb >= FRAME_STATS_RING_SIZE)
+		return false;
+	return read(frame_nb, stats) && stats.frame_nb == frame_nb;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameStatsRing::getLast(FrameStats& stats) const
+{
+	int last = m_last.load(std::memory_order_acquire);
+	if (last < 0)
+		return false;
+	return read(last, stats) && stats.frame_nb == last;
+}
@@ -0,0 +1,96 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <algorithm>
+#include "DhyanaLatencyHistogram.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::reset()
+{
+	for (int i = 0; i < NB_BUCKETS; i++)
+		m_buckets[i].store(0, std::memory_order_relaxed);
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+// @brief highest value counted in a bucket
+//-----------------------------------------------------
+unsigned long long LatencyHistogram::bucketMax(int bucket)
+{
+	if (bucket < SUB)
+		return bucket;
+	int shift = (bucket - SUB) / HALF + 1;
+	unsigned long long sub = (bucket - SUB) % HALF + HALF;
+	return ((sub + 1) << shift) - 1;
+}
+
+//-----------------------------------------------------
+// @brief smallest bucket upper bound with at least percentile % of the values below, limited to the max value
+//-----------------------------------------------------
+double LatencyHistogram::getPercentile(double percentile) const
+{
+	unsigned long long count = 0;
+	for (int i = 0; i < NB_BUCKETS; i++)
+		count += m_buckets[i].load(std::memory_order_relaxed);
+	if (!count)
+		return 0.;
+
+	unsigned long long rank = (unsigned long long) (percentile / 100. * count + 0.5);
+	rank = std::max(1ULL, std::min(rank, count));
+	unsigned long long seen = 0;
+	int bucket = 0;
+	for (; bucket < NB_BUCKETS - 1; bucket++)
+	{
+		seen += m_buckets[bucket].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			break;
+	}
+	return (double) std::min(bucketMax(bucket), m_max.load(std::memory_order_relaxed));
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LatencyHistogram::getStats(int& count, double& mean_us, double& p50_us, double& p99_us, double& max_us) const
+{
+	unsigned long long nb = m_count.load(std::memory_order_relaxed);
+	count = (int) nb;
+	mean_us = nb ? double(m_sum.load(std::memory_order_relaxed)) / nb : 0.;
+	p50_us = getPercentile(50.);
+	p99_us = getPercentile(99.);
+	max_us = (double) m_max.load(std::memory_order_relaxed);
+}
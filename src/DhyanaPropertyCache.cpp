@@ -0,0 +1,168 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "lima/Exceptions.h"
+#include "DhyanaPropertyCache.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//---------------------------
+// @brief  Ctor
+//---------------------------
+PropertyCache::PropertyCache(int nb_properties) :
+m_entries(nb_properties),
+m_hits(0),
+m_misses(0)
+{
+	DEB_CONSTRUCTOR();
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		m_entries[i].valid = false;
+		m_entries[i].max_age = -1.;
+		m_entries[i].value = 0.;
+	}
+}
+
+//-----------------------------------------------------
+// @brief < 0 : cached until invalidated, 0 : never cached, > 0 : cached for max_age seconds
+//-----------------------------------------------------
+void PropertyCache::setMaxAge(int id, double max_age)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(id, max_age);
+	AutoMutex aLock(m_mutex);
+	m_entries.at(id).max_age = max_age;
+	m_entries[id].valid = false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::getMaxAge(int id, double& max_age)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_mutex);
+	max_age = m_entries.at(id).max_age;
+	DEB_RETURN() << DEB_VAR1(max_age);
+}
+
+//-----------------------------------------------------
+// @brief counts the hit or the miss, must be called with the lock
+//-----------------------------------------------------
+bool PropertyCache::isFresh(Entry& entry)
+{
+	bool fresh = entry.valid && entry.max_age != 0. &&
+		(entry.max_age < 0. || double(Timestamp::now()) - double(entry.ts) < entry.max_age);
+	if (fresh)
+		m_hits++;
+	else
+		m_misses++;
+	return fresh;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool PropertyCache::get(int id, double& value)
+{
+	AutoMutex aLock(m_mutex);
+	Entry& entry = m_entries.at(id);
+	if (!isFresh(entry))
+		return false;
+	value = entry.value;
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool PropertyCache::get(int id, std::string& value)
+{
+	AutoMutex aLock(m_mutex);
+	Entry& entry = m_entries.at(id);
+	if (!isFresh(entry))
+		return false;
+	value = entry.text;
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::set(int id, double value)
+{
+	AutoMutex aLock(m_mutex);
+	Entry& entry = m_entries.at(id);
+	entry.value = value;
+	entry.ts = Timestamp::now();
+	entry.valid = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::set(int id, const std::string& value)
+{
+	AutoMutex aLock(m_mutex);
+	Entry& entry = m_entries.at(id);
+	entry.text = value;
+	entry.ts = Timestamp::now();
+	entry.valid = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::invalidate(int id)
+{
+	AutoMutex aLock(m_mutex);
+	m_entries.at(id).valid = false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::invalidateAll()
+{
+	AutoMutex aLock(m_mutex);
+	for (size_t i = 0; i < m_entries.size(); i++)
+		m_entries[i].valid = false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::getHits(int& nb_hits)
+{
+	AutoMutex aLock(m_mutex);
+	nb_hits = m_hits;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void PropertyCache::getMisses(int& nb_misses)
+{
+	AutoMutex aLock(m_mutex);
+	nb_misses = m_misses;
+}
@@ -29,144 +29,410 @@
 #include <signal.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
 #include "lima/Exceptions.h"
 #include "lima/Debug.h"
 #include "lima/MiscUtils.h"
 #include "DhyanaTimer.h"
+#include "DhyanaTrace.h"
 
 #include <time.h>
 #include <sys/time.h>
-#include <signal.h>
 using namespace lima;
 using namespace lima::Dhyana;
 using namespace std;
 
 
+/////////////////////////////
+// CSoftTriggerTimer
+/////////////////////////////
+
+static void addSeconds(struct timespec& ts, double seconds)
+{
+	long long nsec = ts.tv_nsec + (long long) (seconds * 1e9);
+	ts.tv_sec += nsec / 1000000000LL;
+	ts.tv_nsec = nsec % 1000000000LL;
+	if (ts.tv_nsec < 0)
+	{
+		ts.tv_sec--;
+		ts.tv_nsec += 1000000000L;
+	}
+}
+
+static double diffSeconds(const struct timespec& t1, const struct timespec& t0)
+{
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+}
+
 //---------------------------
 // @brief  ctor
-//---------------------------    
-CBaseTimer::CBaseTimer(int period) :
-m_period_ms(period)
+//---------------------------   
+CSoftTriggerTimer::CSoftTriggerTimer(int period, Camera& cam) :
+m_cam(cam),
+m_active(false),
+m_quit(false),
+m_generation(0),
+m_retrigger_ms(period),
+m_frame_period(0),
+m_first_delay(0),
+m_nb_frames(0),
+m_nb_triggers(0),
+m_nb_grabbed(0),
+m_nb_retriggers(0),
+m_nb_jitter(0),
+m_jitter_sum(0),
+m_jitter_sum2(0),
+m_jitter_max(0),
+m_nb_late(0),
+m_seq_lat_time(0),
+m_exp_written(-1),
+m_sdk_busy(false)
 {
+	DEB_CONSTRUCTOR();		
+	Thread::start();
+}
 
-	DEB_CONSTRUCTOR();
+//---------------------------
+// @brief  dtor
+//---------------------------   
+CSoftTriggerTimer::~CSoftTriggerTimer()
+{
+	DEB_DESTRUCTOR();	
+	AutoMutex aLock(m_cond.mutex());
+	m_active = false;
+	m_quit = true;
+	m_cond.broadcast();
+	aLock.unlock();
+	join();
+}
 
-	long m_period_sec = (m_period_ms / 1000); 
-    long m_period_nsec = m_period_ms * 1e06;
+//---------------------------
+// @brief  start triggering, the first trigger is sent after first_delay
+//---------------------------   
+void CSoftTriggerTimer::start(double frame_period, double first_delay)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(frame_period, first_delay);
+	AutoMutex aLock(m_cond.mutex());
+	//the counters of a call in progress belong to the previous acquisition
+	while (m_sdk_busy)
+		m_cond.wait();
+	m_cam.getNbFrames(m_nb_frames);
+	m_frame_period = frame_period;
+	m_first_delay = first_delay;
+	m_nb_triggers = 0;
+	m_nb_grabbed = 0;
+	m_nb_retriggers = 0;
+	m_nb_jitter = 0;
+	m_jitter_sum = 0;
+	m_jitter_sum2 = 0;
+	m_jitter_max = 0;
+	m_nb_late = 0;
+	m_exp_written = -1;
+	m_generation++;
+	m_active = true;
+	m_cond.broadcast();
+}
 
-	m_ts.it_value.tv_sec = m_period_sec;
-    m_ts.it_value.tv_nsec = m_period_nsec;
-    m_ts.it_interval.tv_sec = m_period_sec;
-    m_ts.it_interval.tv_nsec = m_period_nsec;
+void CSoftTriggerTimer::stop()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	m_active = false;
+	m_cond.broadcast();
+	//no trigger or exposure write after stop() returns
+	while (m_sdk_busy)
+		m_cond.wait();
+	DEB_TRACE() << "Number of triggers generated by the Timer = " << m_nb_triggers << ", sent again = " << m_nb_retriggers
+	             << ", late = " << m_nb_late;
+}
 
-	m_ts_reset.it_value.tv_sec = 0;
-    m_ts_reset.it_value.tv_nsec = 0;
-    m_ts_reset.it_interval.tv_sec = 0;
-    m_ts_reset.it_interval.tv_nsec = 0;
+//---------------------------
+// @brief  exposures cycled by the next start, one per trigger
+//---------------------------   
+void CSoftTriggerTimer::setExposureSequence(const std::vector<double>& exp_times, double lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(exp_times.size(), lat_time);
+	AutoMutex aLock(m_cond.mutex());
+	m_exp_sequence = exp_times;
+	m_seq_lat_time = lat_time;
+}
 
-	m_se.sigev_notify = SIGEV_THREAD;
-    m_se.sigev_value.sival_ptr = this;
-    m_se.sigev_notify_function = base_timer_proc;
-    m_se.sigev_notify_attributes = NULL;
+//---------------------------
+// @brief  the previous frame is read out, the next trigger can be sent
+//---------------------------   
+void CSoftTriggerTimer::frameGrabbed()
+{
+	AutoMutex aLock(m_cond.mutex());
+	m_nb_grabbed++;
+	m_cond.broadcast();
+}
 
-	if (-1 == timer_create(CLOCK_REALTIME, &m_se, &m_timer_id)) 
+//---------------------------
+// @brief  statistics of the delay between the deadlines and the real wake up
+//---------------------------   
+void CSoftTriggerTimer::getJitter(double& mean_us, double& std_us, double& max_us)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	mean_us = std_us = max_us = 0;
+	if (m_nb_jitter)
 	{
-		THROW_CTL_ERROR(Error) << "Error creating Timer.";
+		mean_us = m_jitter_sum / m_nb_jitter;
+		std_us = sqrt(std::max(0., m_jitter_sum2 / m_nb_jitter - mean_us * mean_us));
+		max_us = m_jitter_max;
 	}
+	DEB_RETURN() << DEB_VAR3(mean_us, std_us, max_us);
 }
 
 //---------------------------
-// @brief  dtor
+// @brief  sleep until the absolute deadline, by slices to be able to stop, mutex must be locked
+//---------------------------   
+bool CSoftTriggerTimer::sleepUntil(const struct timespec& deadline, int generation)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	while (m_active && !m_quit && m_generation == generation && diffSeconds(deadline, now) > 0)
+	{
+		struct timespec slice = now;
+		addSeconds(slice, 0.1);
+		if (diffSeconds(slice, deadline) > 0)
+			slice = deadline;
+		m_cond.mutex().unlock();
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &slice, NULL) == EINTR)
+			;
+		m_cond.mutex().lock();
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	}
+	return m_active && !m_quit && m_generation == generation;
+}
+
+//---------------------------
+// @brief  time between the trigger and the next one (s)
+//---------------------------   
+double CSoftTriggerTimer::triggerPeriod(int trigger) const
+{
+	if (m_exp_sequence.empty())
+		return m_frame_period;
+	return m_exp_sequence[trigger % m_exp_sequence.size()] + m_seq_lat_time;
+}
+
+//---------------------------
+// @brief  mutex must be locked, it is released during the SDK call
 //---------------------------   
-CBaseTimer::~CBaseTimer()
+void CSoftTriggerTimer::beginSdkCall()
+{
+	m_sdk_busy = true;
+	m_cond.mutex().unlock();
+}
+
+void CSoftTriggerTimer::endSdkCall()
 {
-	DEB_DESTRUCTOR();		
-	stop();
+	m_cond.mutex().lock();
+	m_sdk_busy = false;
+	m_cond.broadcast();
 }
 
 //---------------------------
-// @brief  start
+// @brief  exposure of the trigger, written while the camera waits for it, mutex must be locked
 //---------------------------   
-void CBaseTimer::start()
+void CSoftTriggerTimer::writeExposure(int trigger)
 {
 	DEB_MEMBER_FUNCT();
-	if (-1 == timer_settime(m_timer_id, 0, &m_ts, NULL))
+	if (m_exp_sequence.empty())
+		return;
+	double exp_time = m_exp_sequence[trigger % m_exp_sequence.size()];
+	//no USB transfer if the exposure does not change
+	if (exp_time == m_exp_written)
+		return;
+	beginSdkCall();
+	Trace::begin("exposure write");
+	TUCAMRET ret = TUCAM_Prop_SetValue(m_cam.m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_time * 1000);
+	Trace::end("exposure write");
+	endSdkCall();
+	if (ret != TUCAMRET_SUCCESS)
 	{
-		THROW_CTL_ERROR(Error) << "Error arming Timer.";
+		DEB_ERROR() << "Unable to Write TUIDP_EXPOSURETM " << exp_time << " (s) before trigger " << trigger;
+		m_exp_written = -1;
+		return;
 	}
+	m_exp_written = exp_time;
 }
 
 //---------------------------
-// @brief  stop
+// @brief  trigger loop
 //---------------------------   
-void CBaseTimer::stop()
+void CSoftTriggerTimer::threadFunction()
 {
 	DEB_MEMBER_FUNCT();
-	if (-1 == timer_settime(m_timer_id, 0, &m_ts_reset, NULL)) 
+	Trace::setThreadName("software trigger");
+	AutoMutex aLock(m_cond.mutex());
+	while (!m_quit)
 	{
-		THROW_CTL_ERROR(Error) << "Error disarming Timer.";
+		while (!m_active && !m_quit)
+			m_cond.wait();
+		if (m_quit)
+			break;
+
+		int generation = m_generation;
+		struct timespec deadline, last_trigger, now;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		addSeconds(deadline, m_first_delay);
+		last_trigger = deadline;
+
+		while (m_active && !m_quit && m_generation == generation &&
+		       (!m_nb_frames || m_nb_triggers < m_nb_frames))
+		{
+			//the previous frame must be read out before the next trigger
+			if (m_nb_grabbed < m_nb_triggers)
+			{
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				double timeout = triggerPeriod(m_nb_triggers - 1) + m_retrigger_ms / 1000. - diffSeconds(now, last_trigger);
+				if (timeout > 0)
+				{
+					m_cond.wait(timeout);
+					continue;
+				}
+				//the camera did not take the trigger
+				DEB_WARNING() << "No frame " << m_nb_triggers << " after " << m_retrigger_ms << " ms, trigger sent again";
+				m_nb_retriggers++;
+				beginSdkCall();
+				Trace::begin("software trigger (again)");
+				TUCAM_Cap_DoSoftwareTrigger(m_cam.m_opCam.hIdxTUCam);
+				Trace::end("software trigger (again)");
+				endSdkCall();
+				clock_gettime(CLOCK_MONOTONIC, &last_trigger);
+				continue;
+			}
+
+			//the camera is idle between the readout and the trigger, the exposure can change without re-arming
+			writeExposure(m_nb_triggers);
+
+			//deadline already passed: the trigger waited for the readout, not for the timer
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			bool late = m_nb_triggers > 0 && diffSeconds(deadline, now) <= 0;
+			if (!sleepUntil(deadline, generation))
+				break;
+
+			//counted before the call, a frame grabbed meanwhile must not be taken for the previous one
+			m_nb_triggers++;
+			beginSdkCall();
+			Trace::begin("software trigger");
+			TUCAM_Cap_DoSoftwareTrigger(m_cam.m_opCam.hIdxTUCam);
+			Trace::end("software trigger");
+			clock_gettime(CLOCK_MONOTONIC, &last_trigger);
+			endSdkCall();
+
+			if (late)
+				m_nb_late++;
+			else
+			{
+				double jitter_us = diffSeconds(last_trigger, deadline) * 1e6;
+				m_nb_jitter++;
+				m_jitter_sum += jitter_us;
+				m_jitter_sum2 += jitter_us * jitter_us;
+				if (jitter_us > m_jitter_max)
+					m_jitter_max = jitter_us;
+			}
+
+			//next deadline is one frame period later, no burst of triggers if the readout was late
+			addSeconds(deadline, triggerPeriod(m_nb_triggers - 1));
+			if (diffSeconds(last_trigger, deadline) > 0)
+				deadline = last_trigger;
+		}
+		//wait for the next start
+		if (m_generation == generation)
+			m_active = false;
 	}
 }
 
-
 /////////////////////////////
-// USER MyTimer
+// CAbortWaitTimer
 /////////////////////////////
 
 //---------------------------
 // @brief  ctor
 //---------------------------   
-CSoftTriggerTimer::CSoftTriggerTimer(int period, Camera& cam) :
-CBaseTimer(period),
+CAbortWaitTimer::CAbortWaitTimer(int period, Camera& cam) :
 m_cam(cam),
-m_nb_frames(0),
-m_nb_triggers(0)
+m_period_ms(period),
+m_armed(false),
+m_quit(false),
+m_fired(false)
 {
-	DEB_CONSTRUCTOR();		
+	DEB_CONSTRUCTOR();
+	Thread::start();
 }
 
 //---------------------------
 // @brief  dtor
 //---------------------------   
-CSoftTriggerTimer::~CSoftTriggerTimer()
+CAbortWaitTimer::~CAbortWaitTimer()
 {
-	DEB_DESTRUCTOR();	
+	DEB_DESTRUCTOR();
+	AutoMutex aLock(m_cond.mutex());
+	m_armed = false;
+	m_quit = true;
+	m_cond.broadcast();
+	aLock.unlock();
+	join();
 }
 
-void CSoftTriggerTimer::start()
+//---------------------------
+// @brief  arm the watchdog, it fires after period
+//---------------------------   
+void CAbortWaitTimer::start()
 {
 	DEB_MEMBER_FUNCT();
-	m_nb_triggers = 0;
-	CBaseTimer::start();
-	m_cam.getNbFrames(m_nb_frames);		
+	AutoMutex aLock(m_cond.mutex());
+	m_fired = false;
+	m_armed = true;
+	m_cond.broadcast();
 }
 
-void CSoftTriggerTimer::stop()
+//---------------------------
+// @brief  disarm, waits for an abort in progress
+//---------------------------   
+void CAbortWaitTimer::stop()
 {
 	DEB_MEMBER_FUNCT();
-         CBaseTimer::stop();
-         DEB_TRACE() << "Number of triggers generated by the Timer = "<<m_nb_triggers;
+	AutoMutex aLock(m_cond.mutex());
+	m_armed = false;
+	m_cond.broadcast();
 }
 
 //---------------------------
-// @brief  on_timer
+// @brief  watchdog loop : the frame did not come in time
 //---------------------------   
-void CSoftTriggerTimer::on_timer()
+void CAbortWaitTimer::threadFunction()
 {
 	DEB_MEMBER_FUNCT();
-	//Generate software trigger for each frame, except for the first image
-	//if((!m_cam.m_nb_frames || m_cam.m_acq_frame_nb < m_cam.m_nb_frames) && (m_cam.m_trigger_mode == IntTrig))
+	AutoMutex aLock(m_cond.mutex());
+	while (!m_quit)
 	{
-		if(m_nb_triggers == m_cam.getNbHwAcquiredFrames() && m_nb_triggers < m_nb_frames)
+		while (!m_armed && !m_quit)
+			m_cond.wait();
+		if (m_quit)
+			break;
+
+		struct timespec deadline, now;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		addSeconds(deadline, m_period_ms / 1000.);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		while (m_armed && !m_quit && diffSeconds(deadline, now) > 0)
 		{
-			m_nb_triggers++;
-			//DEB_TRACE() << "CSoftTriggerTimer::on_timer : DoSoftwareTrigger - "<<m_nb_triggers;
-			TUCAM_Cap_DoSoftwareTrigger(m_cam.m_opCam.hIdxTUCam);
+			m_cond.wait(diffSeconds(deadline, now));
+			clock_gettime(CLOCK_MONOTONIC, &now);
+		}
+		//the abort is done under the lock, stop() returns after it
+		if (m_armed && !m_quit)
+		{
+			m_armed = false;
+			m_fired = true;
+			TUCAM_Buf_AbortWait(m_cam.m_opCam.hIdxTUCam);
 		}
 	}
-
-	//This Timer is oneshot, stop() it 
-	//stop();
 }
 
 //-----------------------------------------------------
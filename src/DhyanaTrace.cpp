@@ -0,0 +1,217 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "lima/ThreadUtils.h"
+#include "DhyanaTrace.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+namespace
+{
+
+struct TraceEvent
+{
+	unsigned long long	ts_ns;
+	const char*		name;
+	char			phase;	// B, E or i
+};
+
+//written only by its thread, read by the dump
+struct TraceRing
+{
+	long				tid;
+	std::string			name;
+	std::vector<TraceEvent>		events;
+	std::atomic<unsigned long long>	head;	// nb of events ever written
+	std::atomic<unsigned long long>	start;	// first event since the last clear
+	bool				exited;	// the thread is gone, the ring is kept until its events are cleared
+};
+
+Mutex g_rings_mutex;
+std::vector<TraceRing*> g_rings;
+
+void freeRing(TraceRing* ring)
+{
+	g_rings.erase(std::find(g_rings.begin(), g_rings.end(), ring));
+	delete ring;
+}
+
+//the ring of a thread which exits is freed, unless it has events not yet cleared for the next dump
+struct RingOwner
+{
+	TraceRing*	ring;
+	RingOwner() : ring(NULL) {}
+	~RingOwner()
+	{
+		if (!ring)
+			return;
+		AutoMutex aLock(g_rings_mutex);
+		if (ring->start.load() == ring->head.load())
+			freeRing(ring);
+		else
+			ring->exited = true;
+	}
+};
+
+thread_local RingOwner t_owner;
+thread_local const char* t_name = NULL;
+
+TraceRing* threadRing()
+{
+	if (!t_owner.ring)
+	{
+		TraceRing* ring = new TraceRing;
+		ring->tid = syscall(SYS_gettid);
+		ring->name = t_name ? t_name : "";
+		ring->events.resize(Trace::RING_SIZE);
+		ring->head.store(0);
+		ring->start.store(0);
+		ring->exited = false;
+		AutoMutex aLock(g_rings_mutex);
+		g_rings.push_back(ring);
+		t_owner.ring = ring;
+	}
+	return t_owner.ring;
+}
+
+void writeString(std::ostream& os, const std::string& s)
+{
+	os << '"';
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		if (s[i] == '"' || s[i] == '\\')
+			os << '\\';
+		os << s[i];
+	}
+	os << '"';
+}
+
+} // namespace
+
+std::atomic<bool> Trace::s_enabled(false);
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Trace::setEnabled(bool enable)
+{
+	if (enable && !s_enabled.load())
+		clear();
+	s_enabled.store(enable);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Trace::setThreadName(const char* name)
+{
+	t_name = name;
+	if (t_owner.ring)
+	{
+		AutoMutex aLock(g_rings_mutex);
+		t_owner.ring->name = name;
+	}
+}
+
+//-----------------------------------------------------
+// @brief only the calling thread writes in its ring, the event is visible once head is stored
+//-----------------------------------------------------
+void Trace::record(const char* name, char phase)
+{
+	TraceRing* ring = threadRing();
+	unsigned long long head = ring->head.load(std::memory_order_relaxed);
+	TraceEvent& event = ring->events[head & (RING_SIZE - 1)];
+	event.ts_ns = now();
+	event.name = name;
+	event.phase = phase;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+//-----------------------------------------------------
+// @brief the events are kept in the rings, they are only skipped by the next dumps
+// the rings of the threads which exited are freed
+//-----------------------------------------------------
+void Trace::clear()
+{
+	AutoMutex aLock(g_rings_mutex);
+	for (size_t i = g_rings.size(); i-- > 0;)
+	{
+		if (g_rings[i]->exited)
+			freeRing(g_rings[i]);
+		else
+			g_rings[i]->start.store(g_rings[i]->head.load(std::memory_order_acquire));
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Trace::dump(std::ostream& os)
+{
+	AutoMutex aLock(g_rings_mutex);
+	long pid = getpid();
+	bool first = true;
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	std::vector<TraceEvent> events;
+	for (size_t r = 0; r < g_rings.size(); r++)
+	{
+		TraceRing* ring = g_rings[r];
+		unsigned long long head = ring->head.load(std::memory_order_acquire);
+		unsigned long long begin = std::max(ring->start.load(), head > RING_SIZE ? head - RING_SIZE : 0ULL);
+		events.clear();
+		for (unsigned long long i = begin; i < head; i++)
+			events.push_back(ring->events[i & (RING_SIZE - 1)]);
+		//the events the thread overwrote during the copy are dropped
+		unsigned long long new_head = ring->head.load(std::memory_order_acquire);
+		size_t skip = 0;
+		if (new_head >= RING_SIZE && new_head - RING_SIZE + 1 > begin)
+			skip = std::min((size_t) (new_head - RING_SIZE + 1 - begin), events.size());
+
+		os << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+		   << ",\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+		writeString(os, ring->name.empty() ? "thread " + std::to_string(ring->tid) : ring->name);
+		os << "}}";
+		first = false;
+		for (size_t i = skip; i < events.size(); i++)
+		{
+			const TraceEvent& event = events[i];
+			os << ",\n{\"name\":";
+			writeString(os, event.name);
+			os << ",\"ph\":\"" << event.phase << "\",\"ts\":" << event.ts_ns / 1000 << '.'
+			   << (char) ('0' + event.ts_ns / 100 % 10) << (char) ('0' + event.ts_ns / 10 % 10)
+			   << (char) ('0' + event.ts_ns % 10)
+			   << ",\"pid\":" << pid << ",\"tid\":" << ring->tid;
+			//instant events are shown on their thread only
+			if (event.phase == 'i')
+				os << ",\"s\":\"t\"";
+			os << "}";
+		}
+	}
+	os << "\n]}" << std::endl;
+}
@@ -0,0 +1,56 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <string.h>
+#include "DhyanaUnpack.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief 8 pixels (12 bytes) per loop, read as one 64 bits and one 32 bits little endian word
+//-----------------------------------------------------
+void lima::Dhyana::unpack12(const unsigned char* src, unsigned short* dst, int nb_pixels)
+{
+	int i = 0;
+	for (; i + 8 <= nb_pixels; i += 8, src += 12, dst += 8)
+	{
+		unsigned long long lo;
+		unsigned int hi;
+		memcpy(&lo, src, 8);
+		memcpy(&hi, src + 8, 4);
+		dst[0] = lo & 0xfff;
+		dst[1] = (lo >> 12) & 0xfff;
+		dst[2] = (lo >> 24) & 0xfff;
+		dst[3] = (lo >> 36) & 0xfff;
+		dst[4] = (lo >> 48) & 0xfff;
+		dst[5] = ((lo >> 60) | (hi << 4)) & 0xfff;
+		dst[6] = (hi >> 8) & 0xfff;
+		dst[7] = (hi >> 20) & 0xfff;
+	}
+	for (; i < nb_pixels; i += 2, src += 3, dst += 2)
+	{
+		dst[0] = src[0] | ((src[1] & 0x0f) << 8);
+		if (i + 1 < nb_pixels)
+			dst[1] = (src[1] >> 4) | (src[2] << 4);
+	}
+}
@@ -1,3 +1,4 @@
+import threading
 import PyTango
 from Lima import Core
 from Lima import Dhyana as DhyanaAcq
@@ -26,8 +27,18 @@ class Dhyana(PyTango.Device_4Impl):
                              'HIGH': _DhyanaCam.GainHigh,
                              'LOW': _DhyanaCam.GainLow
                              }
+        self.__BinMode = {'SUM': _DhyanaCam.BinSum,
+                          'AVG': _DhyanaCam.BinAvg
+                          }
+        self.__DropPolicy = {'RENUMBER': _DhyanaCam.DropRenumber,
+                             'BLANK': _DhyanaCam.DropInsertBlank,
+                             'FAULT': _DhyanaCam.DropFault
+                             }
         # self.__Attribute2FunctionBase = {
         # }
+        self.__telemetry_stop = threading.Event()
+        self.__telemetry_thread = None
+        self.__init_thread = None
         
         self.init_device()
 
@@ -35,22 +46,97 @@ class Dhyana(PyTango.Device_4Impl):
 #    Device destructor
 #------------------------------------------------------------------
     def delete_device(self):
-        pass
+        self.__telemetry_stop.set()
+        if self.__telemetry_thread is not None:
+            self.__telemetry_thread.join()
+            self.__telemetry_thread = None
 
 #------------------------------------------------------------------
 #    Device initialization
 #------------------------------------------------------------------
     @Core.DEB_MEMBER_FUNCT
     def init_device(self):
-        self.set_state(PyTango.DevState.ON)
         self.get_device_properties(self.get_device_class())
 
-        if self.temperature_target:
-            _DhyanaCam.setTemperatureTarget(self.temperature_target)
-        if self.trigger_mode:
-            _DhyanaCam.setTriggerMode(self.__TriggerMode[self.trigger_mode.upper()])
-        if self.trigger_edge:
-            _DhyanaCam.setTriggerEdge(self.__TriggerEdge[self.trigger_edge.upper()])
+        # with async_init the camera is opened by its own thread, the properties are applied when it is done
+        if _DhyanaCam.getStatus() == _DhyanaCam.Initializing:
+            self.set_state(PyTango.DevState.INIT)
+            self.set_status('Camera initializing')
+            if self.__init_thread is None or not self.__init_thread.is_alive():
+                self.__init_thread = threading.Thread(target=self.__end_init)
+                self.__init_thread.daemon = True
+                self.__init_thread.start()
+        else:
+            self.__end_init()
+
+        # temperature and fan are pushed when the telemetry thread sees a change, no need to poll them
+        self.set_change_event('temperature', True, False)
+        self.set_change_event('fan_speed', True, False)
+        if self.__telemetry_thread is None:
+            self.__telemetry_stop.clear()
+            self.__telemetry_thread = threading.Thread(target=self.__push_telemetry)
+            self.__telemetry_thread.daemon = True
+            self.__telemetry_thread.start()
+
+#------------------------------------------------------------------
+#    wait for the camera initialization and apply the properties
+#------------------------------------------------------------------
+    def __end_init(self):
+        try:
+            _DhyanaCam.waitInitDone()
+        except Exception as e:
+            self.set_state(PyTango.DevState.FAULT)
+            self.set_status('Camera initialization failed: %s' % e)
+            return
+
+        # runs in the init thread with async_init, an error must not leave the device in INIT
+        try:
+            if self.temperature_target:
+                _DhyanaCam.setTemperatureTarget(self.temperature_target)
+            if self.trigger_mode:
+                _DhyanaCam.setTriggerMode(self.__TriggerMode[self.trigger_mode.upper()])
+            if self.trigger_edge:
+                _DhyanaCam.setTriggerEdge(self.__TriggerEdge[self.trigger_edge.upper()])
+            _DhyanaCam.setZeroCopy(self.zero_copy)
+            if self.nb_sdk_buffers:
+                _DhyanaCam.setNbSdkBuffers(self.nb_sdk_buffers)
+            if self.drop_policy:
+                _DhyanaCam.setDropPolicy(self.__DropPolicy[self.drop_policy.upper()])
+            _DhyanaCam.setTelemetryPeriod(self.telemetry_period)
+        except Exception as e:
+            self.error_stream('Unable to apply the properties: %s' % e)
+            self.set_state(PyTango.DevState.FAULT)
+            self.set_status('Unable to apply the properties: %s' % e)
+            return
+        self.set_state(PyTango.DevState.ON)
+        self.set_status('The device is in ON state.')
+
+#------------------------------------------------------------------
+#    push the change events of the telemetry, reads the camera samples only
+#------------------------------------------------------------------
+    def __push_telemetry(self):
+        last_timestamp = 0
+        last_temperature = None
+        last_fan_speed = None
+        last_error = None
+        while not self.__telemetry_stop.wait(1.0):
+            try:
+                timestamp, temperature, target, fan_speed = _DhyanaCam.getTelemetry()
+                if timestamp == last_timestamp:
+                    continue
+                last_timestamp = timestamp
+                if temperature != last_temperature:
+                    self.push_change_event('temperature', temperature)
+                    last_temperature = temperature
+                if fan_speed != last_fan_speed:
+                    self.push_change_event('fan_speed', fan_speed)
+                    last_fan_speed = fan_speed
+                last_error = None
+            except Exception as e:
+                # logged once until it changes, the thread polls every second
+                if str(e) != last_error:
+                    self.error_stream('Telemetry events not pushed: %s' % e)
+                    last_error = str(e)
 
 #------------------------------------------------------------------
 #    getAttrStringValueList command:
@@ -62,11 +148,136 @@ class Dhyana(PyTango.Device_4Impl):
     def getAttrStringValueList(self, attr_name):
         #use AttrHelper
         return AttrHelper.get_attr_string_value_list(self, attr_name)
+
+#------------------------------------------------------------------
+#    resetLatencyStats command:
+#
+#    Description: clear the latency histograms of all the stages
+#------------------------------------------------------------------
+    @Core.DEB_MEMBER_FUNCT
+    def resetLatencyStats(self):
+        _DhyanaCam.resetLatencyStats()
+
+#------------------------------------------------------------------
+#    dumpTrace command:
+#
+#    Description: write the acquisition timeline (Chrome trace JSON)
+#------------------------------------------------------------------
+    @Core.DEB_MEMBER_FUNCT
+    def dumpTrace(self, file_name):
+        _DhyanaCam.dumpTrace(file_name)
+
+#------------------------------------------------------------------
+#    saveProfile command:
+#
+#    Description: keep the current camera settings under a name
+#------------------------------------------------------------------
+    @Core.DEB_MEMBER_FUNCT
+    def saveProfile(self, name):
+        _DhyanaCam.saveProfile(name)
+
+#------------------------------------------------------------------
+#    applyProfile command:
+#
+#    Description: switch to a saved profile, only the settings which differ are written
+#------------------------------------------------------------------
+    @Core.DEB_MEMBER_FUNCT
+    def applyProfile(self, name):
+        _DhyanaCam.applyProfile(name)
+        # exposure, trigger mode and geometry are also Lima settings, the control would write its own ones at next prepare
+        if _DhyanaControl is not None:
+            _DhyanaControl.acquisition().setAcqExpoTime(_DhyanaCam.getExpTime())
+            _DhyanaControl.acquisition().setTriggerMode(_DhyanaCam.getTrigMode())
+            _DhyanaControl.image().setImageType(_DhyanaCam.getImageType())
+            _DhyanaControl.image().setBin(_DhyanaCam.getBin())
+            _DhyanaControl.image().setRoi(_DhyanaCam.getRoi())
+
+#------------------------------------------------------------------
+#    deleteProfile command:
+#
+#    Description: forget a saved profile
+#------------------------------------------------------------------
+    @Core.DEB_MEMBER_FUNCT
+    def deleteProfile(self, name):
+        _DhyanaCam.deleteProfile(name)
 #==================================================================
 #
 #    Dhyana read/write attribute methods
 #
 #==================================================================
+    def read_trigger_jitter(self, attr):
+        mean_us, std_us, max_us = _DhyanaCam.getTriggerJitter()
+        attr.set_value([mean_us, std_us, max_us])
+
+    def read_frame_period(self, attr):
+        target_ms, mean_ms, max_error_ms = _DhyanaCam.getFramePeriod()
+        attr.set_value([target_ms, mean_ms, max_error_ms])
+
+    def read_timestamp_fit(self, attr):
+        slope, offset, rms_us = _DhyanaCam.getTimestampFit()
+        attr.set_value([slope, offset, rms_us])
+
+    def read_profiles(self, attr):
+        names = _DhyanaCam.getProfileNames()
+        attr.set_value(names.split(',') if names else [])
+
+    def read_profile(self, attr):
+        name, switch_ms, nb_writes = _DhyanaCam.getProfileSwitch()
+        attr.set_value(name)
+
+    def read_profile_switch_time(self, attr):
+        name, switch_ms, nb_writes = _DhyanaCam.getProfileSwitch()
+        attr.set_value(switch_ms)
+
+    def read_profile_nb_writes(self, attr):
+        name, switch_ms, nb_writes = _DhyanaCam.getProfileSwitch()
+        attr.set_value(nb_writes)
+
+    def read_init_timings(self, attr):
+        phases_ms, total_ms = _DhyanaCam.getInitTimings()
+        attr.set_value(list(phases_ms) + [total_ms])
+
+    def read_frame_counters(self, attr):
+        attr.set_value(list(_DhyanaCam.getFrameCounters()))
+
+    def read_latency_stats(self, attr):
+        stats = []
+        for stage in range(_DhyanaCam.NbLatencyStages):
+            stats.append(list(_DhyanaCam.getLatencyStats(stage)))
+        attr.set_value(stats)
+
+    def read_temperature_history(self, attr):
+        timestamps, temperatures, fan_speeds = _DhyanaCam.getTelemetryHistory()
+        attr.set_value(list(temperatures))
+
+    def read_telemetry_time(self, attr):
+        timestamps, temperatures, fan_speeds = _DhyanaCam.getTelemetryHistory()
+        attr.set_value(list(timestamps))
+
+    def read_fan_speed_history(self, attr):
+        timestamps, temperatures, fan_speeds = _DhyanaCam.getTelemetryHistory()
+        attr.set_value(list(fan_speeds))
+
+    def read_frame_stats(self, attr):
+        ok, stats = _DhyanaCam.getFrameStats(-1)
+        if ok:
+            attr.set_value([stats.frame_nb, stats.min, stats.max, stats.mean, stats.nb_saturated])
+        else:
+            attr.set_value([-1, 0, 0, 0, 0])
+
+    def read_frame_histogram(self, attr):
+        attr.set_value(list(_DhyanaCam.getFrameHistogram(-1)))
+
+    def read_exposure_sequence(self, attr):
+        attr.set_value(list(_DhyanaCam.getExposureSequence()))
+
+    def write_exposure_sequence(self, attr):
+        _DhyanaCam.setExposureSequence(list(attr.get_write_value()))
+
+    def read_frame_exposure(self, attr):
+        ok, exp_time = _DhyanaCam.getFrameExposure(-1)
+        attr.set_value(exp_time)
+
     def __getattr__(self,name) :
         #use AttrHelper
         return AttrHelper.get_attr_4u(self,name,_DhyanaCam)
@@ -85,6 +296,12 @@ class DhyanaClass(PyTango.DeviceClass):
         'internal_trigger_timer':
         [PyTango.DevLong,
          "Internal Trigger Timer",999],
+        'camera_id':
+        [PyTango.DevString,
+         "Camera index or serial number (sn:<serial>), the first free camera if empty", ""],
+        'async_init':
+        [PyTango.DevBoolean,
+         "Open the camera in a background thread, the device starts in INIT state", True],
         'temperature_target':
         [PyTango.DevDouble,
          "Temperature set point", -10],
@@ -94,12 +311,39 @@ class DhyanaClass(PyTango.DeviceClass):
         'trigger_edge':
         [PyTango.DevString,
          "trigger edge", "RISING"],
+        'zero_copy':
+        [PyTango.DevBoolean,
+         "SDK writes frames directly into Lima buffers", False],
+        'nb_sdk_buffers':
+        [PyTango.DevLong,
+         "Number of frames in the SDK ring buffer", 4],
+        'drop_policy':
+        [PyTango.DevString,
+         "What to do with frames lost by the SDK", "RENUMBER"],
+        'telemetry_period':
+        [PyTango.DevDouble,
+         "Temperature and fan sampling period (s), 0 to disable", 1.0],
         }
 
     cmd_list = {
         'getAttrStringValueList':
         [[PyTango.DevString, "Attribute name"],
          [PyTango.DevVarStringArray, "Authorized String value list"]],
+        'resetLatencyStats':
+        [[PyTango.DevVoid, ""],
+         [PyTango.DevVoid, ""]],
+        'dumpTrace':
+        [[PyTango.DevString, "File name"],
+         [PyTango.DevVoid, ""]],
+        'saveProfile':
+        [[PyTango.DevString, "Profile name"],
+         [PyTango.DevVoid, ""]],
+        'applyProfile':
+        [[PyTango.DevString, "Profile name"],
+         [PyTango.DevVoid, ""]],
+        'deleteProfile':
+        [[PyTango.DevString, "Profile name"],
+         [PyTango.DevVoid, ""]],
         }
 
     attr_list = {
@@ -130,6 +374,15 @@ class DhyanaClass(PyTango.DeviceClass):
              'format': '',
              'description': 'Camera firmware version',
          }],        
+        'serial_number':
+        [[PyTango.DevString,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Camera serial number',
+         }],
         'temperature_target':
         [[PyTango.DevDouble,
           PyTango.SCALAR,
@@ -175,6 +428,330 @@ class DhyanaClass(PyTango.DeviceClass):
              'format': '',
              'description': 'Detection edge mode, rising or falling',
          }],        
+        'zero_copy':
+        [[PyTango.DevBoolean,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'SDK writes frames directly into Lima buffers (no copy)',
+         }],
+        'nb_sdk_buffers':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'frame',
+             'format': '',
+             'description': 'Number of frames in the SDK ring buffer',
+         }],
+        'queue_high_water_mark':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'frame',
+             'format': '',
+             'description': 'Max nb of frames waiting for delivery to Lima during the last acquisition',
+         }],
+        'buffer_cache_hits':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of acquisitions which reused the SDK buffer',
+         }],
+        'buffer_cache_misses':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of acquisitions which allocated the SDK buffer',
+         }],
+        'init_timings':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 8],
+         {
+             'unit': 'ms',
+             'format': '',
+             'description': 'Duration of the init phases (open, cold start, arm latency, hw timestamp, image type, binning, roi alignment) and total',
+         }],
+        'latency_stats':
+        [[PyTango.DevDouble,
+          PyTango.IMAGE,
+          PyTango.READ, 5, 8],
+         {
+             'unit': 'us',
+             'format': '',
+             'description': 'One line per stage (sdk wait, copy, newFrameReady, delivery, frame period, prepare, start, stop): count, mean, p50, p99, max',
+         }],
+        'profiles':
+        [[PyTango.DevString,
+          PyTango.SPECTRUM,
+          PyTango.READ, 64],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Names of the saved profiles',
+         }],
+        'profile':
+        [[PyTango.DevString,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Last profile applied',
+         }],
+        'profile_switch_time':
+        [[PyTango.DevDouble,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'ms',
+             'format': '',
+             'description': 'Duration of the last applyProfile',
+         }],
+        'profile_nb_writes':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of settings written to the camera by the last applyProfile',
+         }],
+        'tracing':
+        [[PyTango.DevBoolean,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Record the timeline of the acquisition threads, written by the dumpTrace command',
+         }],
+        'telemetry_period':
+        [[PyTango.DevDouble,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 's',
+             'format': '',
+             'description': 'Temperature and fan sampling period, 0 to disable (30 s min during acquisitions)',
+         }],
+        'temperature_history':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 600],
+         {
+             'unit': 'C',
+             'format': '',
+             'description': 'Last temperature samples, oldest first',
+         }],
+        'telemetry_time':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 600],
+         {
+             'unit': 's',
+             'format': '',
+             'description': 'Time of the last samples (s since epoch), oldest first',
+         }],
+        'fan_speed_history':
+        [[PyTango.DevLong,
+          PyTango.SPECTRUM,
+          PyTango.READ, 600],
+         {
+             'unit': 'level',
+             'format': '',
+             'description': 'Last fan speed samples, oldest first',
+         }],
+        'temperature_refresh':
+        [[PyTango.DevDouble,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 's',
+             'format': '',
+             'description': 'The temperature is read from the camera at most once per period, 0 at each read',
+         }],
+        'property_cache_hits':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of property reads answered from the cache',
+         }],
+        'property_cache_misses':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of property reads sent to the camera',
+         }],
+        'trigger_jitter':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 3],
+         {
+             'unit': 'us',
+             'format': '%8.1f',
+             'description': 'Internal trigger jitter: mean, std deviation and max',
+         }],
+        'frame_period':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 3],
+         {
+             'unit': 'ms',
+             'format': '%8.3f',
+             'description': 'Frame period of the last acquisition: target (exp + lat), measured mean and max error',
+         }],
+        'hw_timestamp':
+        [[PyTango.DevBoolean,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Frame timestamps from the camera clock, mapped to the host clock',
+         }],
+        'timestamp_fit':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 3],
+         {
+             'unit': 'N/A',
+             'format': '%g',
+             'description': 'Camera to host clock fit of the last acquisition: slope, offset (s) and rms residual (us)',
+         }],
+        'drop_policy':
+        [[PyTango.DevString,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Frames lost by the SDK: RENUMBER, BLANK or FAULT',
+         }],
+        'dropped_frames':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of frames lost by the SDK during the last acquisition',
+         }],
+        'duplicated_frames':
+        [[PyTango.DevLong,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Nb of frames received twice from the SDK during the last acquisition',
+         }],
+        'frame_counters':
+        [[PyTango.DevLong,
+          PyTango.SPECTRUM,
+          PyTango.READ, 5],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Frames of the current acquisition: received, queued, delivered, dropped, duplicated',
+         }],
+        'frame_statistics':
+        [[PyTango.DevBoolean,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Compute min, max, mean, saturated pixels and histogram during the frame copy',
+         }],
+        'frame_stats':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ, 5],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Last frame: frame nb (-1 if none), min, max, mean, nb of saturated pixels',
+         }],
+        'frame_histogram':
+        [[PyTango.DevLong,
+          PyTango.SPECTRUM,
+          PyTango.READ, 64],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Last frame: histogram, 64 bins over the pixel range',
+         }],
+        'exposure_sequence':
+        [[PyTango.DevDouble,
+          PyTango.SPECTRUM,
+          PyTango.READ_WRITE, 256],
+         {
+             'unit': 's',
+             'format': '',
+             'description': 'Exposures cycled frame by frame in internal trigger, empty: fixed exposure',
+         }],
+        'frame_exposure':
+        [[PyTango.DevDouble,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 's',
+             'format': '',
+             'description': 'Last frame: exposure time (0 if none)',
+         }],
+        'bin_mode':
+        [[PyTango.DevString,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Binned pixel value: SUM or AVG',
+         }],
+        'software_binning':
+        [[PyTango.DevBoolean,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Current binning is not done by the camera but during the copy',
+         }],
+        'keep_armed':
+        [[PyTango.DevBoolean,
+          PyTango.SCALAR,
+          PyTango.READ_WRITE],
+         {
+             'unit': 'N/A',
+             'format': '',
+             'description': 'Camera stays in capture mode between sequences with the same trigger config (internal trigger only)',
+         }],
+        'arm_latency':
+        [[PyTango.DevDouble,
+          PyTango.SCALAR,
+          PyTango.READ],
+         {
+             'unit': 'ms',
+             'format': '%6.1f',
+             'description': 'Delay after capture start before the camera accepts triggers, measured at init',
+         }],
 
     }
 
@@ -187,12 +764,16 @@ class DhyanaClass(PyTango.DeviceClass):
 #----------------------------------------------------------------------------
 _DhyanaCam = None
 _DhyanaInterface = None
+_DhyanaControl = None
 
 def get_control(**keys) :
     global _DhyanaCam
     global _DhyanaInterface
+    global _DhyanaControl
 
     internal_trigger_timer = int(keys.get('internal_trigger_timer', 999))
+    camera_id = keys.get('camera_id', '')
+    async_init = str(keys.get('async_init', 'true')).lower() in ('true', '1')
 
     # print ("Dhyana internal_trigger_timer:", internal_trigger_timer)
     
@@ -200,9 +781,10 @@ def get_control(**keys) :
     # so need to be converted to correct type
 
     if _DhyanaCam is None:
-        _DhyanaCam = DhyanaAcq.Camera(internal_trigger_timer)
+        _DhyanaCam = DhyanaAcq.Camera(internal_trigger_timer, camera_id, async_init)
         _DhyanaInterface = DhyanaAcq.Interface(_DhyanaCam)
-    return Core.CtControl(_DhyanaInterface)
+    _DhyanaControl = Core.CtControl(_DhyanaInterface)
+    return _DhyanaControl
 
 def get_tango_specific_class_n_device():
     return DhyanaClass,Dhyana